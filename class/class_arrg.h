@@ -10,14 +10,23 @@
 
 #include<algorithm>
 #include<cctype>
+#include<cstddef>
 #include<cstdio>
 #include<cstdlib>
 #include<ctime>
 #include<iostream>
+#include<map>
+#include<queue>
+#include<sstream>
 #include<string>
 #include<vector>
+#if __cplusplus >= 201103L
+#include<chrono>
+#endif
 
 #include"class_data.h"
+#include"class_pool.h"
+#include"../lib/my_iterator.h"
 
 #ifndef CLASS_ARRG
 #define CLASS_ARRG
@@ -25,6 +34,7 @@
 #ifndef NOT_USING_STD
 using std::cout;
 using std::endl;
+using std::map;
 using std::vector;
 #endif
 
@@ -42,6 +52,24 @@ using std::vector;
  * 2019.12.03 添加了剪枝函数, 提高了代码效率
  * 2019.12.06 修复了一些已知问题
  * 2019.12.08 整理了剪枝函数, 明显减少了代码量并提高了稳定性
+ * 2026.10.17 使用196位占用掩码代替Blocklist判断冲突, 搜索过程不再复制动态数组
+ * 2026.10.17 添加了enumerate接口, 逐张输出课程表而不必全部保存
+ * 2026.10.17 添加了countlesson接口, 用记忆化搜索统计课程表数量而不生成课程表
+ * 2026.10.17 添加了gettable_parallel接口, 将搜索树分为子树由work-stealing线程池并行搜索
+ * 2026.10.17 添加了setorder接口, 可先搜索可选课程少或冲突多的课程大纲, 使失败的分支尽早被剪去
+ * 2026.10.17 添加了getbest接口, 按评分模型分支定界, 只输出分数最低的若干张课程表
+ * 2026.10.17 Table改为Solution_Store, 只保存所选课程的序号, 课程表在输出时才生成
+ * 2026.10.17 按冲突图的连通分量分别求解, 再对各分量的解作惰性笛卡尔积
+ * 2026.10.17 回溯改为冲突导向的回跳, 并记录学到的不可行组合, 同一死子树不再重复搜索
+ * 2026.10.17 添加了add_course, remove_course与pin_section接口, 修改课程大纲时尽量在已有课程表上增量修改
+ * 2026.10.17 初始课程表中的非空时间在搜索前即从各课程大纲中剔除冲突的课程, 已填入的课程视为固定
+ * 2026.10.17 Arrange改为以日历格式为模板参数的Arrange_T, 占用掩码的大小在编译期确定, Arrange为默认日历的实例
+ * 2026.10.17 占用掩码改为按周次的周×节次掩码, 周次不重叠的课程不再视为冲突; 同一节的各周相邻, 每门课程只需检查少数几个字
+ * 2026.10.17 添加了getsample接口, 按子树的课程表数量加权, 从全部课程表中均匀随机抽样
+ * 2026.10.17 添加了begin与end接口, 返回基于my_lib::iterator的惰性前向迭代器, 每次++才继续回溯
+ * 2026.10.17 添加了Arrange_Stage类, 先排必修课再排选修课, 选修课的课程表按必修课占用的时间缓存
+ * 2026.10.17 同一课程大纲中占用与时间均相同的课程合并为等价类, 只搜索其代表, 得到课程表后再展开
+ * 2026.10.17 定义ARRANGE_STATS时统计各层的结点数、剪枝与回溯次数及各阶段用时, 由getstats以JSON输出
  *********************************************************/
 
 #ifndef CLASS_DATA
@@ -53,8 +81,11 @@ struct _Lesson
 	int t_week; //周次
 	vector<int>t_time; //课程时间, 不计周次
     vector<int>time; //课程时间
+    vector<int>week_time; //按周次的课程时间, 为空时视为在time所在学期段的每一周都有课
 };
 //全局课程表
+//课程表的前Table_size项为各节; 不同周次上课的课程可以共用一节, 第一门按课程大纲的顺序记入该节,
+//其余依次作为附加项接在各节之后, 附加项的number为选课序号, List_number为所共用的节, 通常没有附加项
 struct _Table
 {
     int number; //选课序号
@@ -62,12 +93,224 @@ struct _Table
 };
 #endif
 
-//Arrange类，安排课程
-class Arrange
+//课程表时间的占用掩码, 每一位对应课程表中的一节课, 判断冲突只需按字求与
+//掩码大小由日历在编译期确定, 按字循环的次数为常量, 可被编译器完全展开
+struct _Mask_Word
+{
+    int index; //字的下标
+    unsigned long long bits; //字的内容
+};
+template<int Size>
+struct _Time_Mask
+{
+    enum { size=Size,Words=(Size+63)/64 };
+    unsigned long long bits[Words];
+
+    void clear(void)
+    {
+        for (int i=0;i<Words;i++) bits[i]=0;
+    }
+    void set(int pos)
+    {
+        if (pos>=0&&pos<size) bits[pos>>6]|=1ULL<<(pos&63);
+    }
+    bool test(int pos) const
+    {
+        return pos>=0&&pos<size&&(bits[pos>>6]>>(pos&63)&1ULL);
+    }
+    void merge(const _Time_Mask &other)
+    {
+        for (int i=0;i<Words;i++) bits[i]|=other.bits[i];
+    }
+    bool intersect(const _Time_Mask &other) const
+    {
+        for (int i=0;i<Words;i++) if (bits[i]&other.bits[i]) return true;
+        return false;
+    }
+    void restrict(const _Time_Mask &other)
+    {
+        for (int i=0;i<Words;i++) bits[i]&=other.bits[i];
+    }
+    void remove(const _Time_Mask &other)
+    {
+        for (int i=0;i<Words;i++) bits[i]&=~other.bits[i];
+    }
+    //以下以稀疏形式words给出另一个掩码, 只处理其非零字, 用于非零字很少的课程掩码
+    void getwords(vector<_Mask_Word>&words) const
+    {
+        words.clear();
+        for (int i=0;i<Words;i++)
+        {
+            if (bits[i]==0) continue;
+            _Mask_Word word={i,bits[i]};
+            words.push_back(word);
+        }
+    }
+    bool intersect(const vector<_Mask_Word>&words) const
+    {
+        for (int i=0;i<words.size();i++) if (bits[words[i].index]&words[i].bits) return true;
+        return false;
+    }
+    void merge(const vector<_Mask_Word>&words)
+    {
+        for (int i=0;i<words.size();i++) bits[words[i].index]|=words[i].bits;
+    }
+    void remove(const vector<_Mask_Word>&words)
+    {
+        for (int i=0;i<words.size();i++) bits[words[i].index]&=~words[i].bits;
+    }
+    bool operator<(const _Time_Mask &other) const
+    {
+        for (int i=0;i<Words;i++) if (bits[i]!=other.bits[i]) return bits[i]<other.bits[i];
+        return false;
+    }
+};
+
+//bits中最高位与最低位的1的位置, bits不能为0; GCC与Clang使用内建函数, 其他编译器二分查找
+inline int _Bit_High(unsigned long long bits)
+{
+#if defined(__GNUC__)
+    return 63-__builtin_clzll(bits);
+#else
+    int h=0;
+    for (int shift=32;shift>0;shift>>=1)
+    {
+        if (bits>>shift) h+=shift,bits>>=shift;
+    }
+    return h;
+#endif
+}
+inline int _Bit_Low(unsigned long long bits)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    return _Bit_High(bits&(~bits+1));
+#endif
+}
+
+//回溯中学到的不可行组合的数量上限与每个组合的层数上限
+#define NOGOOD_LIMIT 4096
+#define NOGOOD_SIZE 8
+
+//定义ARRANGE_STATS时统计搜索过程, 否则统计语句不参与编译
+#ifdef ARRANGE_STATS
+#define ARRANGE_STAT(statement) statement
+#else
+#define ARRANGE_STAT(statement)
+#endif
+
+//统计用的计时, 单位为秒; C++11及以上为墙上时间, 否则为处理器时间
+inline double _Stats_Clock(void)
+{
+#if __cplusplus >= 201103L
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+//Arrange类的搜索统计, 只在定义ARRANGE_STATS时累加, 调用clearstats前各次搜索的结果累计在一起
+struct _Arrange_Stats
+{
+    vector<unsigned long long>node; //node[j]为搜索顺序中第j层扩展的结点数, 即该层选入课程的次数
+    unsigned long long conflict; //与已选课程冲突而被剪去的课程数
+    unsigned long long nogood; //因学到的不可行组合而被剪去的课程数
+    unsigned long long backtrack; //某层遍历完后回溯的次数
+    unsigned long long backjump; //其中越过至少一层的回跳次数
+    unsigned long long memo; //countlesson与getsample中记忆化命中的次数
+    unsigned long long bound; //getbest中因分数下界被剪去的课程数
+    unsigned long long solution; //搜索到达叶结点的次数, 各连通分量分别计数, 且每个叶结点只对应各层等价类的代表
+    unsigned long long table; //展开等价类后输出的课程表数量
+    double time_setinvList; //各阶段的用时: 生成invList, 叠放课程, 生成搜索顺序, 搜索
+    double time_laylesson;
+    double time_order;
+    double time_search;
+
+    _Arrange_Stats()
+    {
+        clear();
+    }
+
+    //清零, node保留原有的层数
+    void clear(void)
+    {
+        node.assign(node.size(),0);
+        conflict=nogood=backtrack=backjump=memo=bound=solution=table=0;
+        time_setinvList=time_laylesson=time_order=time_search=0;
+    }
+
+    //并入另一份统计, 用于合并各线程或各搜索状态的统计
+    void merge(const _Arrange_Stats &other)
+    {
+        if (node.size()<other.node.size()) node.resize(other.node.size(),0);
+        for (int j=0;j<other.node.size();j++) node[j]+=other.node[j];
+        conflict+=other.conflict;
+        nogood+=other.nogood;
+        backtrack+=other.backtrack;
+        backjump+=other.backjump;
+        memo+=other.memo;
+        bound+=other.bound;
+        solution+=other.solution;
+        table+=other.table;
+        time_setinvList+=other.time_setinvList;
+        time_laylesson+=other.time_laylesson;
+        time_order+=other.time_order;
+        time_search+=other.time_search;
+    }
+
+    //以JSON格式输出
+    void getjson(std::string &json) const
+    {
+        std::ostringstream out;
+#ifdef ARRANGE_STATS
+        out<<"{\"enabled\":true,\"node\":[";
+#else
+        out<<"{\"enabled\":false,\"node\":[";
+#endif
+        for (int j=0;j<node.size();j++) out<<(j?",":"")<<node[j];
+        out<<"],\"conflict\":"<<conflict<<",\"nogood\":"<<nogood<<",\"backtrack\":"<<backtrack<<",\"backjump\":"<<backjump;
+        out<<",\"memo\":"<<memo<<",\"bound\":"<<bound<<",\"solution\":"<<solution<<",\"table\":"<<table;
+        out<<",\"time\":{\"setinvList\":"<<time_setinvList<<",\"laylesson\":"<<time_laylesson<<",\"order\":"<<time_order<<",\"search\":"<<time_search<<"}}";
+        json=out.str();
+    }
+};
+
+//Arrange类的搜索顺序
+enum _Order_Mode
+{
+    ORDER_INPUT, //按输入顺序
+    ORDER_FEWEST, //可选课程最少的课程大纲优先
+    ORDER_CONFLICT //与其他课程冲突最多的课程大纲优先; 对课程而言, 冲突最少的课程优先
+};
+
+//课程表评分模型, 分数越低越好, 各权重均应不小于0
+struct _Score_Model
+{
+    int early_weight; //每节第1、2节课的扣分
+    int day_weight; //每个需要到校的日子的扣分, 上下半学期分别计算
+    int gap_weight; //同一天内两节课之间每个空闲节次的扣分
+    map<int,int>lesson_penalty; //按选课序号的额外扣分, 如需要避开的教学楼
+
+    _Score_Model()
+    {
+        early_weight=0;
+        day_weight=0;
+        gap_weight=0;
+    }
+};
+
+//Arrange类，安排课程, 以日历格式Calendar实例化
+template<typename Calendar>
+class Arrange_T
 {
     public:
-        //构造函数，输入需安排的课程起始位与终末位
-        Arrange(int a,int b,int c=196)
+        typedef _Time_Mask<Calendar::week_size> _Mask; //按周次的占用掩码
+        typedef _Time_Mask<Calendar::size> _Cell_Mask; //课程表中各节的掩码, 不区分周次
+        typedef char _Calendar_check[Calendar::days*Calendar::terms<=64?1:-1]; //getbest按位记录占用的日子, 日子总数不能超过64
+
+        //构造函数，输入需安排的课程起始位与终末位, 以及课程表大小
+        Arrange_T(int a,int b,int c=Calendar::size)
         {
             begin_lesson=a;
             end_lesson=b;
@@ -78,21 +321,27 @@ class Arrange
             _Table_default_temp.List_number=-1;
             vector<_Table>Table_default_temp(Table_size,_Table_default_temp);
             Table_default.assign(Table_default_temp.begin(),Table_default_temp.end()); //设置默认初始课程表
+            Course_order_mode=ORDER_INPUT;
+            Lesson_order_mode=ORDER_INPUT;
+            amount_table=0;
+            Table_ready=false;
+            Stage_mask.clear();
         }
         //析构函数
-        ~Arrange()
+        ~Arrange_T()
         {
             /* 原本写了个用*ptr,new[]和delete[]的方案, 但为了增加代码可读性而用了vector. 毕竟stl它不香吗? */
         }
 
-        //对外接口：输入课程信息
+        //对外接口：输入课程信息, 时间超出课程表或日历的课程无法安排, 与空课程一样跳过
         void setlesson(_Lesson input[])
         {
             int course_index=-1,course_temp=-1;
             _Arrange_Lesson setlesson_temp;
-            for (int i=0;i<amount_lesson;i++)
+            List.clear(); //重新输入时替换原有的课程
+            for (int i=0;i<end_lesson-begin_lesson+1;i++) //amount_lesson已被setinvList改为实际课程数, 按起始位与终末位读取
             {
-                if (input[begin_lesson+i].time.size()!=0)
+                if (input[begin_lesson+i].time.size()!=0&&if_inside(input[begin_lesson+i]))
                 {
                     if(course_temp<input[begin_lesson+i].course) //将输入的course信息连续化，以便于操作
                     {
@@ -100,39 +349,465 @@ class Arrange
                         course_index++;
                     }
                     //输入至setlesson_temp
-                    int sign1=input[begin_lesson+i].number;
                     setlesson_temp.number=input[begin_lesson+i].number;
                     setlesson_temp.course=course_index;
                     setlesson_temp.time.assign(input[begin_lesson+i].time.begin(),input[begin_lesson+i].time.end());
+                    setmask(setlesson_temp,input[begin_lesson+i].week_time);
                     //压栈 (实际上是"压堆")
                     List.push_back(setlesson_temp);
                 }
             }
-            amount_lesson=List.size();
             amount_course=course_index+1;
+            Pinned.assign(amount_course,-1);
+            setinvList();
+            Table_ready=false;
+        }
+
+        //对外接口：增量添加一项课程大纲, input[0]~input[amount-1]为其各门课程, 返回其编号
+        //已有课程表时只需对每张课程表补上不冲突的新课程, 不必重新搜索
+        //与setlesson相同, 空课程与时间超出课程表或日历的课程被跳过, 全部被跳过时不添加, 返回-1
+        int add_course(const _Lesson input[],int amount)
+        {
+            int course_index=amount_course,amount_before=List.size();
+            _Arrange_Lesson setlesson_temp;
+            for (int i=0;i<amount;i++)
+            {
+                if (input[i].time.size()==0||!if_inside(input[i])) continue;
+                setlesson_temp.number=input[i].number;
+                setlesson_temp.course=course_index;
+                setlesson_temp.time.assign(input[i].time.begin(),input[i].time.end());
+                setmask(setlesson_temp,input[i].week_time);
+                List.push_back(setlesson_temp);
+            }
+            if (List.size()==amount_before) return -1;
+            amount_course++;
+            Pinned.push_back(-1);
+            setinvList();
+            if (!Table_ready) return course_index;
+            for (int k=0;k<invList[course_index].size();k++)
+            {
+                if (if_tablepinned(List[invList[course_index][k]])) //新课程被初始课程表固定时占用掩码需重新生成
+                {
+                    gettable(Table);
+                    return course_index;
+                }
+            }
+            //对每张课程表补上新课程
+            Solution_Store Table_next;
+            vector<int>choice;
+            _Mask occupied;
+            resetstore(Table_next);
+            for (int t=0;t<Table.size();t++)
+            {
+                Table.get(t,choice);
+                occupied=Block_mask;
+                for (int i=0;i<course_index;i++) occupied.merge(List[invList[i][choice[i]]].mask);
+                choice.push_back(0);
+                for (int k=0;k<invList[course_index].size();k++)
+                {
+                    const _Arrange_Lesson &lesson=List[invList[course_index][k]];
+                    if (lesson.self_conflict||lesson.mask.intersect(occupied)) continue;
+                    choice[course_index]=k;
+                    Table_next.push(choice);
+                }
+            }
+            Table.swap(Table_next);
+            amount_table=Table.size();
+            return course_index;
+        }
+
+        //对外接口：增量删除第course项课程大纲, 之后的课程大纲编号减一
+        //删除课程大纲可能使原本冲突的组合变得可行, 因此需重新搜索, 但课程的占用掩码不必重新生成
+        void remove_course(int course)
+        {
+            if (course<0||course>=amount_course) return;
+            vector<_Arrange_Lesson>List_next;
+            for (int i=0;i<amount_lesson;i++)
+            {
+                if (List[i].course==course) continue;
+                List_next.push_back(List[i]);
+                if (List_next.back().course>course) List_next.back().course--;
+            }
+            List.swap(List_next);
+            amount_course--;
+            Pinned.erase(Pinned.begin()+course);
             setinvList();
+            if (Table_ready) gettable(Table);
+        }
+
+        //对外接口：将第course项课程大纲固定为其中第index门课程, index为-1时取消固定
+        //固定时只需从已有课程表中筛选, 取消固定时需重新搜索
+        void pin_section(int course,int index)
+        {
+            if (course<0||course>=amount_course||index>=(int)invList[course].size()||Pinned[course]==index) return;
+            bool if_filter=(index>=0&&Pinned[course]<0);
+            Pinned[course]=index;
+            if (!Table_ready) return;
+            if (!if_filter)
+            {
+                gettable(Table);
+                return;
+            }
+            Solution_Store Table_next;
+            vector<int>choice;
+            resetstore(Table_next);
+            for (int t=0;t<Table.size();t++)
+            {
+                Table.get(t,choice);
+                if (choice[course]==index) Table_next.push(choice);
+            }
+            Table.swap(Table_next);
+            amount_table=Table.size();
+        }
+
+        //对外接口：当前的全部课程表, 由gettable或增量接口维护, 可用buildtable生成课程表
+        const Solution_Store &getsolution(void) const
+        {
+            return Table;
+        }
+
+        //对外接口：设置搜索顺序, 只影响搜索效率与课程表的输出顺序, 不影响结果
+        //course_order为课程大纲的顺序, 可为ORDER_INPUT, ORDER_FEWEST或ORDER_CONFLICT
+        //lesson_order为每项课程大纲内课程的顺序, 可为ORDER_INPUT或ORDER_CONFLICT
+        void setorder(int course_order,int lesson_order=ORDER_INPUT)
+        {
+            Course_order_mode=course_order;
+            Lesson_order_mode=lesson_order;
         }
 
         //对外接口：输入初始课程表
         void settable(const vector<_Table>domain_Table)
         {
             Table_default.assign(domain_Table.begin(),domain_Table.end()); //设置默认初始课程表
+            if (Table_default.size()>Table_size) Table_default.resize(Table_size); //附加项不作为初始课程
+            Table_ready=false;
+        }
+
+        //对外接口：输入前一阶段(如必修课)的课程表已占用的时间, 按周次区分, 与之冲突的课程在搜索前即被剔除
+        void setblock(const _Mask &block)
+        {
+            Stage_mask=block;
+            Table_ready=false;
+        }
+
+        //对外接口：所有课程可能占用的时间, 前一阶段在此之外的占用不影响本阶段的课程表
+        void getcover(_Mask &cover) const
+        {
+            cover.clear();
+            for (int i=0;i<amount_lesson;i++) cover.merge(List[i].mask);
         }
         
         //对外接口：输出课程表
         bool gettable(vector<vector<_Table> >&codomain_Table)
         {
-            bool if_success;
-            laylesson(Table_default);
-            if_success=arrangelesson(Table_default);
-            codomain_Table.assign(Table.begin(),Table.end());
+            bool if_success=gettable(Table);
+            buildtable(Table,codomain_Table);
+            return if_success;
+        }
+
+        //对外接口：以紧凑形式输出课程表, 每张课程表只保存所选课程的序号, 需要时由buildtable生成
+        bool gettable(Solution_Store &codomain_Solution)
+        {
+            _Product_State product;
+            vector<int>k,e,choice;
+            preparelesson();
+            ARRANGE_STAT(double start=_Stats_Clock());
+            setproduct(product);
+            resetstore(codomain_Solution);
+            while (nextproduct(product,k))
+            {
+                e.assign(amount_course,0);
+                do //展开各层的等价类
+                {
+                    getindex(k,e,choice);
+                    codomain_Solution.push(choice);
+                } while (nextequal(k,e));
+            }
+            amount_table=codomain_Solution.size();
+            ARRANGE_STAT(Stats.table+=amount_table);
+            ARRANGE_STAT(Stats.time_search+=_Stats_Clock()-start);
+            if (&codomain_Solution==&Table) Table_ready=true;
+            return amount_table!=0;
+        }
+
+#if __cplusplus >= 201103L
+        //对外接口：多线程输出课程表, 结果顺序与gettable相同, thread_count不大于0时使用硬件线程数
+        bool gettable_parallel(vector<vector<_Table> >&codomain_Table,int thread_count=0)
+        {
+            bool if_success=gettable_parallel(Table,thread_count);
+            buildtable(Table,codomain_Table);
+            return if_success;
+        }
+
+        //对外接口：多线程以紧凑形式输出课程表
+        bool gettable_parallel(Solution_Store &codomain_Solution,int thread_count=0)
+        {
+            Steal_Pool pool(thread_count);
+            preparelesson();
+            ARRANGE_STAT(double start=_Stats_Clock());
+            //按前几项课程大纲的选择将搜索树分为若干子树, 子树数量约为线程数的8倍以便窃取
+            vector<_Search_State>task_state;
+            setsubtree(task_state,8*pool.size());
+#ifdef ARRANGE_STATS
+            for (int t=0;t<task_state.size();t++) task_state[t].stats.clear(); //各子树复制了划分子树时的统计, 不重复计入
+#endif
+            vector<Solution_Store>task_solution(task_state.size()); //每棵子树的解
+            auto task=[&](int t)
+            {
+                vector<int>e,choice;
+                resetstore(task_solution[t]);
+                while (branch(task_state[t]))
+                {
+                    e.assign(amount_course,0);
+                    do
+                    {
+                        getindex(task_state[t].k,e,choice);
+                        task_solution[t].push(choice);
+                    } while (nextequal(task_state[t].k,e));
+                }
+            };
+            pool.run(task_state.size(),task);
+            //按子树顺序合并, 即为单线程时的顺序
+            resetstore(codomain_Solution);
+            for (int t=0;t<task_solution.size();t++)
+            {
+                codomain_Solution.append(task_solution[t]);
+                Solution_Store().swap(task_solution[t]);
+                ARRANGE_STAT(Stats.merge(task_state[t].stats));
+            }
+            amount_table=codomain_Solution.size();
+            ARRANGE_STAT(Stats.table+=amount_table);
+            ARRANGE_STAT(Stats.time_search+=_Stats_Clock()-start);
+            return amount_table!=0;
+        }
+#endif
+
+        //对外接口：由紧凑形式生成第index张课程表
+        void buildtable(const Solution_Store &domain_Solution,int index,vector<_Table>&codomain_Table)
+        {
+            vector<int>choice;
+            domain_Solution.get(index,choice);
+            buildtable(choice,codomain_Table);
+        }
+
+        //对外接口：由一张课程表的紧凑形式生成课程表, choice[i]为第i项课程大纲所选课程在invList中的序号
+        void buildtable(const vector<int>&choice,vector<_Table>&codomain_Table)
+        {
+            codomain_Table.assign(Table_default.begin(),Table_default.end());
+            for (int i=0;i<amount_course;i++) puttable(codomain_Table,invList[i][choice[i]]);
+        }
+
+        //对外接口：由紧凑形式生成全部课程表
+        void buildtable(const Solution_Store &domain_Solution,vector<vector<_Table> >&codomain_Table)
+        {
+            codomain_Table.resize(domain_Solution.size());
+            for (int i=0;i<domain_Solution.size();i++) buildtable(domain_Solution,i,codomain_Table[i]);
+        }
+
+        //对外接口：逐张枚举课程表, 不保存结果
+        //visitor(const vector<_Table>&)每得到一张课程表即被调用一次, 返回false时提前结束枚举
+        template<typename Visitor>bool enumerate(Visitor visitor)
+        {
+            preparelesson();
+            ARRANGE_STAT(double start=_Stats_Clock());
+            bool if_success=arrangelesson(Table_default,visitor);
+            ARRANGE_STAT(Stats.time_search+=_Stats_Clock()-start);
             return if_success;
         }
         
+        //Arrange类的惰性前向迭代器, 定义见_Search_State之后
+        class iterator;
+
+        //对外接口：指向第一张课程表的迭代器, 此时才开始搜索
+        iterator begin(void)
+        {
+            iterator first;
+            preparelesson();
+            first.arrange=this;
+            resetstate(first.state);
+            first.next();
+            return first;
+        }
+
+        //对外接口：遍历结束的迭代器
+        iterator end(void)
+        {
+            return iterator();
+        }
+
+        //对外接口：仅统计课程表总数, 并在marginal中给出每个选课序号出现在多少张课程表中, 不生成课程表
+        unsigned long long countlesson(map<int,unsigned long long>&marginal)
+        {
+            preparelesson();
+            ARRANGE_STAT(double start_time=_Stats_Clock());
+            setRest_mask();
+            Count_memo.assign(amount_course+1,map<_Mask,unsigned long long>());
+            _Mask start=Block_mask;
+            start.restrict(Rest_mask[0]);
+            //连通分量在搜索顺序中相邻, 分量交界处的占用状态只有一种, 因此总数即为各分量课程表数量之积
+            unsigned long long total=amount_course>0?countbranch(0,start):0; //没有课程大纲时无解
+            //正向统计到达每个占用状态的方式数, 与反向的剩余数相乘即得每门课程的出现次数
+            marginal.clear();
+            map<_Mask,unsigned long long>layer,layer_next;
+            layer[start]=1;
+            for (int j=0;j<amount_course;j++)
+            {
+                layer_next.clear();
+                for (typename map<_Mask,unsigned long long>::iterator it=layer.begin();it!=layer.end();++it)
+                {
+                    for (int k=0;k<Order_List[j].size();k++)
+                    {
+                        const _Arrange_Lesson &lesson=List[Order_List[j][k]];
+                        if (lesson.self_conflict||lesson.mask.intersect(it->first)) continue;
+                        _Mask next=it->first;
+                        next.merge(lesson.mask);
+                        next.restrict(Rest_mask[j+1]);
+                        unsigned long long rest=countbranch(j+1,next);
+                        if (rest==0) continue;
+                        const vector<int>&equal=Equal_List[Order_List[j][k]]; //等价类中的每门课程各得到一组课程表
+                        layer_next[next]+=it->second*equal.size();
+                        for (int m=0;m<equal.size();m++) marginal[List[equal[m]].number]+=it->second*rest;
+                    }
+                }
+                layer.swap(layer_next);
+            }
+            ARRANGE_STAT(Stats.time_search+=_Stats_Clock()-start_time);
+            return total;
+        }
+
+        //对外接口：从全部课程表中均匀随机抽取amount张(可重复), seed相同时结果相同
+        //每一层按各课程之下子树的课程表数量加权选择, 子树数量由countbranch记忆化得到, 不必枚举全部课程表
+        bool getsample(int amount,unsigned long long seed,Solution_Store &codomain_Solution)
+        {
+            resetstore(codomain_Solution);
+            if (amount<=0) return false;
+            preparelesson();
+            ARRANGE_STAT(double start_time=_Stats_Clock());
+            setRest_mask();
+            Count_memo.assign(amount_course+1,map<_Mask,unsigned long long>());
+            _Mask start=Block_mask;
+            start.restrict(Rest_mask[0]);
+            if (amount_course==0||countbranch(0,start)==0)
+            {
+                ARRANGE_STAT(Stats.time_search+=_Stats_Clock()-start_time);
+                return false;
+            }
+            vector<int>k(amount_course),e(amount_course),choice;
+            for (int t=0;t<amount;t++)
+            {
+                _Mask occupied=start;
+                for (int j=0;j<amount_course;j++)
+                {
+                    unsigned long long target=getrandom(seed,countbranch(j,occupied)); //第target张以occupied为起点的课程表
+                    for (k[j]=0;;k[j]++)
+                    {
+                        const _Arrange_Lesson &lesson=List[Order_List[j][k[j]]];
+                        if (lesson.self_conflict||occupied.intersect(lesson.words)) continue;
+                        _Mask next=occupied;
+                        next.merge(lesson.words);
+                        next.restrict(Rest_mask[j+1]);
+                        unsigned long long rest=countbranch(j+1,next),size=Equal_List[Order_List[j][k[j]]].size();
+                        if (target<rest*size)
+                        {
+                            e[j]=target/rest; //等价类中的各门课程之下的课程表数量相同
+                            occupied=next;
+                            break;
+                        }
+                        target-=rest*size;
+                    }
+                }
+                getindex(k,e,choice);
+                codomain_Solution.push(choice);
+            }
+            ARRANGE_STAT(Stats.table+=amount);
+            ARRANGE_STAT(Stats.time_search+=_Stats_Clock()-start_time);
+            return true;
+        }
+
+        //对外接口：均匀随机抽取amount张课程表
+        bool getsample(int amount,unsigned long long seed,vector<vector<_Table> >&codomain_Table)
+        {
+            Solution_Store sample;
+            bool if_success=getsample(amount,seed,sample);
+            buildtable(sample,codomain_Table);
+            return if_success;
+        }
+
+        //对外接口：按评分模型输出分数最低的amount_best张课程表, 分数由低到高存入score
+        //搜索时剪去分数下界不低于当前第amount_best名的子树, 不必枚举所有课程表
+        bool getbest(int amount_best,const _Score_Model &model,vector<vector<_Table> >&codomain_Table,vector<long long>&score)
+        {
+            codomain_Table.clear();
+            score.clear();
+            if (amount_best<=0) return false;
+            preparelesson();
+            ARRANGE_STAT(double start=_Stats_Clock());
+            _Best_State state(model,amount_best);
+            setbest(state);
+            state.k.assign(amount_course,-1);
+            state.occupied=Block_mask;
+            state.cost.assign(amount_course+1,0);
+            state.day.assign(amount_course+1,0);
+            _Cell_Mask empty;
+            empty.clear();
+            state.chosen.assign(amount_course+1,empty);
+            if (amount_course>0&&state.rest_cost[0]>=0) bestbranch(0,state);
+            //堆顶为最差的课程表, 逆序取出
+            vector<_Best_Table>best;
+            while (!state.best.empty())
+            {
+                best.push_back(state.best.top());
+                state.best.pop();
+            }
+            vector<_Table>Table_temp(Table_default);
+            for (int i=best.size()-1;i>=0;i--)
+            {
+                filltable(Table_temp,best[i].k,best[i].e);
+                codomain_Table.push_back(Table_temp);
+                cleartable(Table_temp,best[i].k,best[i].e);
+                score.push_back(best[i].score);
+            }
+            ARRANGE_STAT(Stats.table+=codomain_Table.size());
+            ARRANGE_STAT(Stats.time_search+=_Stats_Clock()-start);
+            return !codomain_Table.empty();
+        }
+
+        //对外接口：搜索统计, 只在定义ARRANGE_STATS时累加
+        const _Arrange_Stats &getstats(void) const
+        {
+            return Stats;
+        }
+
+        //对外接口：以JSON格式输出搜索统计, 各层按搜索顺序排列
+        void getstats(std::string &json) const
+        {
+            Stats.getjson(json);
+        }
+
+        //对外接口：清零搜索统计
+        void clearstats(void)
+        {
+            Stats.clear();
+        }
+
         //对外接口：测试函数, 输出课程信息
         int getamount(void)
         {
-            return Table.size();
+            return amount_table;
+        }
+
+        //对外接口：能安排的课程大纲数, 不含没有可用课程的课程大纲, 为0时各接口都视为无解
+        int getcourse(void) const
+        {
+            return amount_course;
+        }
+
+        //对外接口：课程大纲中课程数的最大值, 即紧凑形式中序号的上界(不含)
+        int getwidth(void) const
+        {
+            int max_size=0;
+            for (int i=0;i<amount_course;i++) if (invList[i].size()>max_size) max_size=invList[i].size();
+            return max_size;
         }
 
         //对外接口：测试函数, 输出课程信息
@@ -168,19 +843,220 @@ class Arrange
             int number; //选课序号
             int course; //课程大纲
             vector<int>time; //课程时间
+            vector<_Mask_Word>words; //mask的非零字, 判断冲突与合并时只需处理这些字
+            vector<int>cells; //按周次的占用所在的各节(学期段与节次), 即cover中的各位
+            _Cell_Mask cover; //按周次的占用所在的各节, 两门课程的cover不相交时必不冲突
+            bool full; //是否占用cover中各节所在学期段的每一周, 是时与占用cover中同一节的课程必然冲突
+            bool self_conflict; //课程自身的时间是否重叠, 重叠的课程无法排入课程表
+            _Mask mask; //课程时间按周次的占用掩码, 较大, 放在最后使搜索时常用的成员位于同一缓存行
+        };
+        //Arrange类内搜索状态, 取代原先branch中的static变量
+        struct _Search_State
+        {
+            bool started; //是否已开始遍历
+            int floor; //前floor项课程大纲的选择固定不变, 只遍历其下的子树
+            int ceil; //只遍历第ceil层之前的课程大纲, 用于单独求解一个连通分量
+            vector<int>k; //第j层选择了Order_List[j]中的第k[j]门课程
+            _Mask occupied; //初始课程表与当前各层所选课程占用的时间, 已选课程互不重叠, 回溯时只需按课程的非零字撤销
+            vector<int>owner; //课程表中每一节最近被第几层的课程占用, 用于快速找出冲突的来源, 需再验证该层的课程仍占用这一节
+            vector<unsigned long long>conflict; //conflict中第j段为第j层的冲突集, 即导致第j层课程被剪去的各层, 每段Depth_words个字
+            vector<char>found; //found[j]表示第j层当前的遍历中是否找到过解, 找到过解时只能按时间顺序回溯
+            map<long long,vector<vector<int> > >nogood; //已学到的不能同时出现的课程组合, 以其中最深一层的(层, 课程编码)为键, 值为其余各层的层与课程编码
+            int amount_nogood; //已学到的组合数
+#ifdef ARRANGE_STATS
+            _Arrange_Stats stats; //本状态的搜索统计, 搜索结束后并入Stats, 使各线程不必共享计数
+#endif
+        };
+
+    public:
+        //Arrange类的惰性前向迭代器, 每次++时从上一张课程表继续回溯, 只搜索实际用到的课程表
+        //顺序与gettable相同; 迭代期间修改课程大纲、搜索顺序或初始课程表会使迭代器失效
+        class iterator:public my_lib::iterator<my_lib::forward_iterator_tag,vector<_Table>,std::ptrdiff_t,const vector<_Table>*,const vector<_Table>&>
+        {
+            public:
+                iterator()
+                {
+                    arrange=NULL;
+                    index=-1;
+                }
+
+                const vector<_Table>&operator*() const
+                {
+                    return table;
+                }
+                const vector<_Table>*operator->() const
+                {
+                    return &table;
+                }
+                iterator &operator++()
+                {
+                    next();
+                    return *this;
+                }
+                iterator operator++(int)
+                {
+                    iterator temp(*this);
+                    next();
+                    return temp;
+                }
+                //遍历结束的迭代器都相等, 否则比较是否为同一Arrange的同一张课程表
+                bool operator==(const iterator &other) const
+                {
+                    return arrange==other.arrange&&index==other.index;
+                }
+                bool operator!=(const iterator &other) const
+                {
+                    return !(*this==other);
+                }
+                //当前课程表中所选课程按周次占用的时间, 不含初始课程表, 可作为下一阶段的setblock输入
+                void getmask(_Mask &mask) const
+                {
+                    mask=state.occupied;
+                    if (arrange!=NULL) mask.remove(arrange->Block_mask);
+                }
+                //当前课程表的紧凑形式, 即每项课程大纲所选课程在invList中的序号, 可由buildtable还原
+                void getindex(vector<int>&choice) const
+                {
+                    if (arrange!=NULL) arrange->getindex(state.k,equal,choice);
+                    else choice.clear();
+                }
+
+            private:
+                friend class Arrange_T;
+                Arrange_T *arrange; //遍历结束时为NULL
+                int index; //当前为第几张课程表
+                _Search_State state; //回溯的状态, 复制迭代器时一并复制, 两者可分别前进
+                vector<int>equal; //当前一组解中各层在等价类中所取的课程
+                vector<_Table>table; //当前的课程表
+
+                //内部函数：展开当前一组解的下一种方式, 已展开完时回溯至下一组解
+                //与enumerate相同, 先清除上一张课程表所选的课程再填入新的课程, 不重新复制整张课程表
+                //每次的用时计入搜索用时, 不含调用者处理课程表的时间, 遍历结束时与其他统计一并并入
+                void next(void)
+                {
+                    if (arrange==NULL) return;
+                    ARRANGE_STAT(double start=_Stats_Clock());
+                    if (index<0) table.assign(arrange->Table_default.begin(),arrange->Table_default.end());
+                    else arrange->cleartable(table,state.k,equal);
+                    if (index<0||!arrange->nextequal(state.k,equal))
+                    {
+                        if (!arrange->branch(state))
+                        {
+                            ARRANGE_STAT(state.stats.time_search+=_Stats_Clock()-start);
+                            ARRANGE_STAT(arrange->Stats.merge(state.stats)); //遍历结束时并入统计
+                            arrange=NULL;
+                            index=-1;
+                            table.clear();
+                            return;
+                        }
+                        equal.assign(arrange->amount_course,0);
+                    }
+                    index++;
+                    ARRANGE_STAT(state.stats.table++);
+                    arrange->filltable(table,state.k,equal);
+                    ARRANGE_STAT(state.stats.time_search+=_Stats_Clock()-start);
+                }
         };
+
+    private:
         vector<_Arrange_Lesson>List; //其元素为课程信息
         vector<vector<int> >invList; //其元素为动态数组，数组的个数为课程大纲总数，数组的元素为课程大纲所对应课程的编码
-        vector<vector<_Table> >Table; //其元素为动态数组，每个数组是一张课程表，数组的个数为可能的课程表总数，数组的元素为各时间的课程信息
+        int Course_order_mode,Lesson_order_mode; //课程大纲与课程的搜索顺序
+        vector<int>Course_order; //搜索顺序, 第j层搜索第Course_order[j]项课程大纲
+        vector<int>Course_depth; //Course_order的逆, 第i项课程大纲在第Course_depth[i]层搜索
+        vector<vector<int> >Order_List; //按搜索顺序排列的invList, 回溯均在Order_List上进行, 其中只有各等价类的代表
+        vector<vector<int> >Equal_List; //Equal_List[i]为以第i门课程为代表的等价类, 即同一课程大纲中占用与时间均相同的课程, 首个即为其本身
+        int amount_component; //冲突图的连通分量数
+        vector<int>Course_component; //每项课程大纲所属的连通分量
+        int Depth_words; //冲突集中每层占用的字数
+        vector<int>Component_begin; //搜索顺序中第c个连通分量占据第Component_begin[c]层至第Component_begin[c+1]-1层
+        Solution_Store Table; //所有可能的课程表, 每张课程表只保存每项课程大纲所选课程在invList中的序号
+        int amount_table; //上一次gettable得到的课程表数量
+        bool Table_ready; //Table是否为当前课程大纲的全部课程表, 为true时增量接口直接在Table上修改
+        vector<int>Pinned; //每项课程大纲固定选择的课程在invList中的序号, -1表示不固定
+        vector<int>Table_pinned; //每项课程大纲被初始课程表固定的课程在invList中的序号, -1表示不固定
+        vector<int>Lesson_index; //每门课程在其课程大纲的invList中的序号
         vector<_Table>Table_default; //一张初始课程表，在构造函数中每节课都被初始化为-1
         vector<vector<int> >Table_layer; //由所有课程在时间表上叠成的层，用于确认哪些课程与哪些课程冲突。其元素为动态数组，每个数组是一节课的时间，数组的元素为这一时间的课程编码
-        vector<int>Blocklist; //一个FILO栈，用于标出所有与当前课程冲突的课程，其元素为课程编码
-        vector<int>Blocknumber; //一个FILO栈，记录了每次压入Blocklist的课程个数
+        _Mask Block_mask; //初始课程表中已被占用的时间, 初始课程表不区分周次, 非空的一节在其学期段的每一周都被占用
+        _Mask Stage_mask; //前一阶段的课程表已占用的时间, 由setblock输入, 搜索前并入Block_mask
+        _Arrange_Stats Stats; //搜索统计, 由getstats输出
+        vector<_Mask>Rest_mask; //Rest_mask[j]为第j项及之后的课程大纲可能占用的时间, 之外的时间不影响后续搜索
+        vector<map<_Mask,unsigned long long> >Count_memo; //Count_memo[j]记录从第j项课程大纲开始, 各占用状态下的课程表数量
         
+        //内部函数：判断课程的时间是否都在课程表与日历之内
+        bool if_inside(const _Lesson &input)
+        {
+            for (int l=0;l<input.time.size();l++)
+            {
+                if (input.time[l]<0||input.time[l]>=Table_size||input.time[l]>=Calendar::size) return false;
+            }
+            for (int l=0;l<input.week_time.size();l++)
+            {
+                if (input.week_time[l]<0||input.week_time[l]>=Calendar::week_size) return false;
+            }
+            return true;
+        }
+
+        //内部函数：生成课程按周次的占用掩码, week_time为空时按time所在的学期段生成
+        void setmask(_Arrange_Lesson &lesson,const vector<int>&week_time)
+        {
+            lesson.mask.clear();
+            lesson.self_conflict=false;
+            if (week_time.empty())
+            {
+                for (int l=0;l<lesson.time.size();l++)
+                {
+                    if (setcell(lesson.mask,lesson.time[l])) lesson.self_conflict=true;
+                }
+            }
+            for (int l=0;l<week_time.size();l++)
+            {
+                if (lesson.mask.test(week_time[l])) lesson.self_conflict=true;
+                lesson.mask.set(week_time[l]);
+            }
+            lesson.mask.getwords(lesson.words);
+            //由按周次的占用生成cover, 再检查cover中各节的每一周是否都被占用
+            lesson.cover.clear();
+            for (int pos=0;pos<Calendar::week_size;pos++)
+            {
+                if (lesson.mask.test(pos)) lesson.cover.set(Calendar::term(pos%Calendar::weeks)*Calendar::term_size+pos/Calendar::weeks);
+            }
+            _Mask cell_mask;
+            cell_mask.clear();
+            lesson.cells.clear();
+            for (int c=0;c<Calendar::size;c++)
+            {
+                if (!lesson.cover.test(c)) continue;
+                lesson.cells.push_back(c);
+                setcell(cell_mask,c);
+            }
+            lesson.full=!(lesson.mask<cell_mask||cell_mask<lesson.mask);
+        }
+
+        //内部函数：将课程表中的第time节按其学期段的每一周计入掩码, 返回其中是否有已被占用的时间
+        bool setcell(_Mask &mask,int time)
+        {
+            if (time<0||time>=Calendar::size) return false;
+            int term=time/Calendar::term_size,slot=time%Calendar::term_size;
+            bool overlap=false;
+            for (int w=0;w<Calendar::weeks;w++)
+            {
+                if (Calendar::term(w)!=term) continue;
+                if (mask.test(slot*Calendar::weeks+w)) overlap=true;
+                mask.set(slot*Calendar::weeks+w);
+            }
+            return overlap;
+        }
+
         //内部函数：生成课程大纲对应的课程
         void setinvList(void)
         {
+            ARRANGE_STAT(double start=_Stats_Clock());
             vector<int>setinvList_temp;
+            amount_lesson=List.size();
+            Depth_words=(amount_course+63)/64;
+            invList.clear();
             for (int i=0;i<amount_course;i++)
             {
                 setinvList_temp.clear();
@@ -193,6 +1069,12 @@ class Arrange
                 }
                 invList.push_back(setinvList_temp); //将缓存压入invList
             }
+            Lesson_index.assign(amount_lesson,-1);
+            for (int i=0;i<amount_course;i++)
+            {
+                for (int k=0;k<invList[i].size();k++) Lesson_index[invList[i][k]]=k;
+            }
+            ARRANGE_STAT(Stats.time_setinvList+=_Stats_Clock()-start);
         }
 
         //内部函数：叠放课程至课程表层
@@ -200,145 +1082,811 @@ class Arrange
         {
             vector<int>temp_lay; //temp_lay是每节时间段的第一层课程，其元素为课程编码
             //初始化课程表层
+            Table_layer.clear();
+            Block_mask.clear();
             for (int i=0;i<Table_size;i++)
             {
                 temp_lay.push_back(Table_layer_temp[i].List_number);
                 Table_layer.push_back(temp_lay); //在课程表层的每一节时间叠上初始课程
                 temp_lay.pop_back();
-                //后续增加将非空的初始课程提前压入Blocklist的代码
+                if (Table_layer_temp[i].number!=-1) setcell(Block_mask,i); //非空的初始课程直接计入占用掩码, 在搜索前即剪去与之冲突的课程
             }
             //叠放课程
             for (int i=0;i<amount_lesson;i++)
             {
                 for (int j=0;j<List[i].time.size();j++)
                 {
+                    if (List[i].time[j]<0||List[i].time[j]>=Table_size) continue;
                     if (Table_layer[List[i].time[j]][0]==-1) Table_layer[List[i].time[j]].pop_back(); //如果一节时间有课，则弹出初始值-1
                     Table_layer[List[i].time[j]].push_back(i); //在时间List[i].time上叠放课程
                 }
             }
         }
 
-        //内部函数：动态数组压入元素
-        template<typename T>void vector_push(T &Block_list,int &Block_sum_number,const vector<int>&k,int j)
+        //内部函数：搜索前的准备, 叠放课程, 处理初始课程表中固定的课程并生成搜索顺序
+        void preparelesson(void)
         {
-            vector<int>layer_temp;
-            Block_sum_number=0;
-            for (int i=0;i<List[invList[j][k[j]]].time.size();i++)
+            ARRANGE_STAT(double start=_Stats_Clock());
+            laylesson(Table_default);
+            ARRANGE_STAT(double middle=_Stats_Clock());
+            ARRANGE_STAT(Stats.time_laylesson+=middle-start);
+            //初始课程表中已完整填入的课程视为固定, 其时间不再作为占用, 而是只允许该课程使用
+            Table_pinned.assign(amount_course,-1);
+            for (int i=0;i<amount_lesson;i++)
             {
-                layer_temp.assign(Table_layer[List[invList[j][k[j]]].time[i]].begin(),Table_layer[List[invList[j][k[j]]].time[i]].end());
-                delete_from_vector_int(layer_temp,invList[j][k[j]]);
-                Blocklist.insert(Blocklist.end(),layer_temp.begin(),layer_temp.end());
-                Block_sum_number+=layer_temp.size();
+                if (Table_pinned[List[i].course]<0&&if_tablepinned(List[i])) Table_pinned[List[i].course]=Lesson_index[i];
             }
-        }
-
-        //内部函数：动态数组弹出元素
-        template<typename T>void vector_pop(T &input_vector,int pop_num)
-        {
-            for (int i=0;i<pop_num;i++)
+            for (int i=0;i<amount_course;i++)
             {
-                input_vector.pop_back(); //从队尾弹出pop_num个元素
+                if (Table_pinned[i]<0) continue;
+                const _Arrange_Lesson &lesson=List[invList[i][Table_pinned[i]]];
+                _Mask pinned_mask;
+                pinned_mask.clear();
+                for (int l=0;l<lesson.time.size();l++) setcell(pinned_mask,lesson.time[l]);
+                Block_mask.remove(pinned_mask);
             }
+            Block_mask.merge(Stage_mask);
+            setorder_list();
+            ARRANGE_STAT(if (Stats.node.size()<amount_course) Stats.node.resize(amount_course,0));
+            ARRANGE_STAT(Stats.time_order+=_Stats_Clock()-middle);
         }
 
-        //内部函数：从动态数组中删除指定元素
-        void delete_from_vector_int(vector<int>&target_vec,int to_delete)
+        //内部函数：判断课程是否被初始课程表固定, 即其每节课在初始课程表中都已填入该课程的选课序号
+        bool if_tablepinned(const _Arrange_Lesson &lesson)
         {
-            vector<int>::iterator it=find(target_vec.begin(),target_vec.end(),to_delete);
-            while (it!=target_vec.end())
-            {	
-                it=target_vec.erase(it);
-            	it=find(it,target_vec.end(),to_delete);
+            if (lesson.time.empty()||lesson.self_conflict) return false;
+            for (int l=0;l<lesson.time.size();l++)
+            {
+                if (lesson.time[l]<0||lesson.time[l]>=Table_size||Table_default[lesson.time[l]].number!=lesson.number) return false;
             }
+            return true;
         }
 
-        //内部函数：判断数列是否与输入值重复以及下标是否越界
-        bool if_continue(const vector<int>&k,int j)
-        {
-            if (k[j]>=invList[j].size()) return true;
-            else return (count(Blocklist.begin(),Blocklist.end(),invList[j][k[j]])!=0);
-        }
-
-        //内部函数：回溯
-        bool branch(vector<int>&k)
+        //内部函数：按Course_order_mode与Lesson_order_mode生成Course_order与Order_List
+        //与初始课程表冲突或自身冲突的课程在搜索前即被剔除, 固定的课程大纲只保留固定的课程
+        void setorder_list(void)
         {
-            static bool pushed=false;
-            int Block_sum_number=0;
-
-            for (int j=0;j<amount_course;j++)
+            //每项课程大纲可选的课程
+            vector<vector<int> >domain(amount_course);
+            vector<char>in_domain(amount_lesson,false);
+            for (int i=0;i<amount_course;i++)
             {
-                if (k[j]==-1||(pushed&&j==amount_course-1)) k[j]++;
-                if (j!=0&&!pushed)
+                for (int k=0;k<invList[i].size();k++)
                 {
-                    vector_push(Blocklist,Block_sum_number,k,j-1);
-                    Blocknumber.push_back(Block_sum_number);
+                    const _Arrange_Lesson &lesson=List[invList[i][k]];
+                    if (Table_pinned[i]>=0&&k!=Table_pinned[i]) continue;
+                    if (Pinned[i]>=0&&k!=Pinned[i]) continue;
+                    if (lesson.self_conflict||lesson.mask.intersect(Block_mask)) continue;
+                    domain[i].push_back(invList[i][k]);
                 }
-                while (if_continue(k,j))
+            }
+            //占用与时间均相同的课程只保留第一门作为代表参与搜索, 得到课程表后再展开为等价类中的各门课程
+            Equal_List.assign(amount_lesson,vector<int>());
+            for (int i=0;i<amount_course;i++)
+            {
+                vector<int>representative;
+                for (int k=0;k<domain[i].size();k++)
                 {
-                    if (k[j]<invList[j].size()-1)
+                    int r=0;
+                    while (r<representative.size()&&!if_equal(List[representative[r]],List[domain[i][k]])) r++;
+                    if (r==representative.size())
                     {
-                        k[j]++;
+                        representative.push_back(domain[i][k]);
+                        in_domain[domain[i][k]]=true;
                     }
-                    else
+                    Equal_List[representative[r]].push_back(domain[i][k]);
+                }
+                domain[i].swap(representative);
+            }
+            //每门课程与其他课程大纲中的课程冲突的次数
+            vector<int>conflict(amount_lesson,0);
+            if (Course_order_mode==ORDER_CONFLICT||Lesson_order_mode==ORDER_CONFLICT)
+            {
+                for (int a=0;a<amount_lesson;a++)
+                {
+                    if (!in_domain[a]) continue;
+                    for (int b=a+1;b<amount_lesson;b++)
                     {
-                        k[j]=0;
-                        j--;
-                        pushed=false;
-                        if (j<0) return false;
-                        k[j]++;
-                        vector_pop(Blocklist,Blocknumber.back());
-                        Blocknumber.pop_back();
+                        if (in_domain[b]&&List[a].course!=List[b].course&&List[a].mask.intersect(List[b].mask))
+                        {
+                            conflict[a]++;
+                            conflict[b]++;
+                        }
                     }
                 }
             }
-            pushed=true;
-            return true;
+            //每项课程大纲的排序键, 越小越先搜索
+            vector<long long>course_key(amount_course,0);
+            for (int i=0;i<amount_course;i++)
+            {
+                if (Course_order_mode==ORDER_FEWEST) course_key[i]=domain[i].size();
+                if (Course_order_mode==ORDER_CONFLICT)
+                {
+                    for (int k=0;k<domain[i].size();k++) course_key[i]-=conflict[domain[i][k]];
+                }
+            }
+            Course_order.resize(amount_course);
+            for (int i=0;i<amount_course;i++) Course_order[i]=i;
+            std::stable_sort(Course_order.begin(),Course_order.end(),_Key_Less<long long>(course_key));
+            //同一连通分量的课程大纲排在一起, 分量之间按其最先搜索的课程大纲排序
+            setcomponent(in_domain);
+            vector<long long>component_rank(amount_component,-1),course_rank(amount_course);
+            for (int j=0,rank=0;j<amount_course;j++)
+            {
+                if (component_rank[Course_component[Course_order[j]]]<0) component_rank[Course_component[Course_order[j]]]=rank++;
+            }
+            for (int i=0;i<amount_course;i++) course_rank[i]=component_rank[Course_component[i]];
+            std::stable_sort(Course_order.begin(),Course_order.end(),_Key_Less<long long>(course_rank));
+            Component_begin.assign(amount_component+1,amount_course);
+            for (int j=amount_course-1;j>=0;j--) Component_begin[course_rank[Course_order[j]]]=j;
+            Course_depth.resize(amount_course);
+            for (int j=0;j<amount_course;j++) Course_depth[Course_order[j]]=j;
+            Order_List.resize(amount_course);
+            for (int j=0;j<amount_course;j++)
+            {
+                Order_List[j]=domain[Course_order[j]];
+                if (Lesson_order_mode==ORDER_CONFLICT) std::stable_sort(Order_List[j].begin(),Order_List[j].end(),_Key_Less<int>(conflict));
+            }
+        }
+
+        //内部函数：判断两门课程是否等价, 即按周次的占用与课程表中的时间均相同
+        bool if_equal(const _Arrange_Lesson &a,const _Arrange_Lesson &b)
+        {
+            if (a.mask<b.mask||b.mask<a.mask||a.time.size()!=b.time.size()) return false;
+            vector<int>time_a(a.time),time_b(b.time);
+            std::sort(time_a.begin(),time_a.end());
+            std::sort(time_b.begin(),time_b.end());
+            return time_a==time_b;
+        }
+
+        //内部函数：由按周次的占用掩码生成课程大纲的冲突图, 并用并查集求出连通分量
+        //两项课程大纲中有课程在同一周的同一时间上课即视为两者冲突, 不在可选范围in_domain内的课程不计
+        void setcomponent(const vector<char>&in_domain)
+        {
+            vector<int>parent(amount_course);
+            for (int i=0;i<amount_course;i++) parent[i]=i;
+            for (int a=0;a<amount_lesson;a++)
+            {
+                if (!in_domain[a]) continue;
+                for (int b=a+1;b<amount_lesson;b++)
+                {
+                    if (!in_domain[b]||List[a].course==List[b].course) continue;
+                    int root_a=findroot(parent,List[a].course),root_b=findroot(parent,List[b].course);
+                    if (root_a!=root_b&&List[b].mask.intersect(List[a].words)) parent[root_b]=root_a;
+                }
+            }
+            //按课程大纲的输入顺序为连通分量编号
+            Course_component.assign(amount_course,-1);
+            amount_component=0;
+            vector<int>root_component(amount_course,-1);
+            for (int i=0;i<amount_course;i++)
+            {
+                int root=findroot(parent,i);
+                if (root_component[root]<0) root_component[root]=amount_component++;
+                Course_component[i]=root_component[root];
+            }
+        }
+
+        //内部函数：并查集求根
+        int findroot(vector<int>&parent,int i)
+        {
+            while (parent[i]!=i)
+            {
+                parent[i]=parent[parent[i]];
+                i=parent[i];
+            }
+            return i;
+        }
+
+        //内部类：按排序键比较下标
+        template<typename T>struct _Key_Less
+        {
+            const vector<T>&key;
+            _Key_Less(const vector<T>&input_key):key(input_key) { }
+            bool operator()(int a,int b) const
+            {
+                return key[a]<key[b];
+            }
+        };
+
+        //内部函数：将按搜索顺序的k与等价类中的e转换为按课程大纲顺序的课程编码, choice[i]为第i项课程大纲所选课程的编码
+        void getchoice(const vector<int>&k,const vector<int>&e,vector<int>&choice)
+        {
+            choice.resize(amount_course);
+            for (int j=0;j<amount_course;j++) choice[Course_order[j]]=Equal_List[Order_List[j][k[j]]][e[j]];
+        }
+
+        //内部函数：将按搜索顺序的k与等价类中的e转换为按课程大纲顺序的invList序号, 即Solution_Store中保存的形式
+        void getindex(const vector<int>&k,const vector<int>&e,vector<int>&choice)
+        {
+            getchoice(k,e,choice);
+            for (int i=0;i<amount_course;i++) choice[i]=Lesson_index[choice[i]];
         }
 
-        //内部函数：生成课程表
-        bool arrangelesson(vector<_Table>Table_temp)
+        //内部函数：一组解k的下一种展开方式, e[j]为第j层在等价类中所取的课程, 从全为0开始, 已展开完时返回false
+        bool nextequal(const vector<int>&k,vector<int>&e)
         {
-            //vector<int>Table_temp(98,-1);
-            int time_cur_course;
-            bool failed=true,k_i_failed=false;
-            vector<int>k(amount_course,-1);
-            vector<_Table>Table_Temp_bak;
-            Table_Temp_bak.assign(Table_temp.begin(),Table_temp.end());
-            //遍历(invList[0].size()*invList[1].size()*...*invList[amount_course].size())维空间
-            while (branch(k))
+            for (int j=amount_course-1;j>=0;j--)
             {
-                k_i_failed=false;
-                for (int i=0;i<amount_course;i++) //第i项课程大纲中第k[i]门课程
+                if (++e[j]<Equal_List[Order_List[j][k[j]]].size()) return true;
+                e[j]=0;
+            }
+            return false;
+        }
+
+        //内部函数：按课程大纲数与最大课程数设置Solution_Store的格式并清空
+        void resetstore(Solution_Store &store)
+        {
+            store.reset(amount_course,getwidth());
+        }
+
+        //内部函数：判断第j层的第k[j]门课程是否与已选课程冲突、是否属于已学到的不可行组合以及下标是否越界
+        //冲突的来源记入第j层的冲突集, 初始课程表与子树的固定前缀不计入
+        bool if_continue(_Search_State &state,int j)
+        {
+            if (state.k[j]>=Order_List[j].size()) return true;
+            int List_number=Order_List[j][state.k[j]];
+            const _Arrange_Lesson &lesson=List[List_number];
+            if (lesson.self_conflict) return true;
+            if (state.occupied.intersect(lesson.words))
+            {
+                //冲突集只需记入最浅的一层, 以便尽可能远地回跳
+                //先检查同一节的占用层, 周次不同的课程可能共用一节, 找不到时再逐层检查
+                int culprit=j;
+                for (int l=0;l<lesson.cells.size();l++)
+                {
+                    int depth=state.owner[lesson.cells[l]];
+                    if (depth<state.floor||depth>=culprit) continue;
+                    const _Arrange_Lesson &other=List[Order_List[depth][state.k[depth]]];
+                    if (other.cover.test(lesson.cells[l])&&(lesson.full||other.full||other.mask.intersect(lesson.words))) culprit=depth;
+                }
+                for (int depth=state.floor;culprit==j&&depth<j;depth++)
+                {
+                    const _Arrange_Lesson &other=List[Order_List[depth][state.k[depth]]];
+                    if (other.cover.intersect(lesson.cover)&&other.mask.intersect(lesson.words)) culprit=depth;
+                }
+                if (culprit<j) setdepth(state,j,culprit);
+                ARRANGE_STAT(state.stats.conflict++);
+                return true;
+            }
+            std::map<long long,vector<vector<int> > >::const_iterator it=state.nogood.find((long long)j*amount_lesson+List_number);
+            if (it==state.nogood.end()) return false;
+            for (int n=0;n<it->second.size();n++)
+            {
+                const vector<int>&other=it->second[n];
+                bool matched=true;
+                for (int i=0;i<other.size()&&matched;i+=2) matched=(Order_List[other[i]][state.k[other[i]]]==other[i+1]);
+                if (matched)
                 {
-                    for (int l=0;l<List[invList[i][k[i]]].time.size();l++) //第k门课程中第l节课
+                    for (int i=0;i<other.size();i+=2) setdepth(state,j,other[i]);
+                    ARRANGE_STAT(state.stats.nogood++);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //内部函数：将第depth层记入第j层的冲突集
+        void setdepth(_Search_State &state,int j,int depth)
+        {
+            state.conflict[j*Depth_words+(depth>>6)]|=1ULL<<(depth&63);
+        }
+
+        //内部函数：进入第j层, 清空该层的冲突集
+        void enterdepth(_Search_State &state,int j)
+        {
+            state.k[j]=-1;
+            state.found[j]=false;
+            for (int w=0;w<Depth_words;w++) state.conflict[j*Depth_words+w]=0;
+        }
+
+        //内部函数：第j层已遍历完, 给出应回到的层, 小于floor时表示子树已遍历完
+        //该层之下找到过解时按时间顺序回溯, 否则回跳至冲突集中最深的一层h, 并将其余各层并入h的冲突集
+        int backjump(_Search_State &state,int j)
+        {
+            if (state.found[j]) return j-1;
+            int h=-1;
+            for (int w=Depth_words-1;w>=0&&h<0;w--)
+            {
+                unsigned long long bits=state.conflict[j*Depth_words+w];
+                if (bits) h=w*64+_Bit_High(bits);
+            }
+            if (h<state.floor) return -1; //冲突集为空, 说明第j层在固定的前缀下无解
+            //学习不可行组合: 冲突集中各层当前的课程不能同时出现
+            if (state.amount_nogood<NOGOOD_LIMIT)
+            {
+                vector<int>other;
+                for (int w=0;w<Depth_words;w++)
+                {
+                    for (unsigned long long bits=state.conflict[j*Depth_words+w];bits;bits&=bits-1)
                     {
-                        time_cur_course=List[invList[i][k[i]]].time[l];
-                        if (Table_temp[time_cur_course].number==-1) //第k门课程填写成功
-                        {
-                            Table_temp[time_cur_course].number=List[invList[i][k[i]]].number;
-                            Table_temp[time_cur_course].List_number=invList[i][k[i]];
-                        }
-                        else
-                        {
-                            k_i_failed=true;
-                            break;
-                        }
+                        int depth=w*64+_Bit_Low(bits);
+                        if (depth==h) continue;
+                        other.push_back(depth);
+                        other.push_back(Order_List[depth][state.k[depth]]);
                     }
-                    if (k_i_failed)
+                }
+                if (other.size()<=2*NOGOOD_SIZE)
+                {
+                    state.nogood[(long long)h*amount_lesson+Order_List[h][state.k[h]]].push_back(other);
+                    state.amount_nogood++;
+                }
+            }
+            for (int w=0;w<Depth_words;w++) state.conflict[h*Depth_words+w]|=state.conflict[j*Depth_words+w];
+            state.conflict[h*Depth_words+(h>>6)]&=~(1ULL<<(h&63));
+            return h;
+        }
+
+        //内部函数：回溯, 每次调用给出下一组互不冲突的k, 遍历结束时返回false
+        //某层无课可选时回跳至导致冲突的最深一层, 而非仅退回上一层
+        bool branch(_Search_State &state)
+        {
+            int j;
+            if (!state.started)
+            {
+                state.started=true;
+                if (state.floor==state.ceil) //所有课程大纲均已固定时仅有一组解, 没有课程大纲时无解
+                {
+                    if (amount_course==0) return false;
+                    ARRANGE_STAT(state.stats.solution++);
+                    return true;
+                }
+                j=state.floor;
+                enterdepth(state,j);
+            }
+            else
+            {
+                if (state.floor==state.ceil) return false;
+                j=state.ceil-1; //从上一组解的最后一项继续
+                unsetlesson(state,j);
+            }
+            while (j>=state.floor)
+            {
+                state.k[j]++;
+                while (state.k[j]<Order_List[j].size()&&if_continue(state,j)) state.k[j]++;
+                if (state.k[j]>=Order_List[j].size())
+                {
+                    int h=backjump(state,j); //第j项已遍历完, 回溯
+                    ARRANGE_STAT(state.stats.backtrack++);
+                    ARRANGE_STAT(if (h<j-1) state.stats.backjump++);
+                    for (j--;j>=h&&j>=state.floor;j--) unsetlesson(state,j); //撤销第h层至第j-1层所选的课程
+                    j=h;
+                    continue;
+                }
+                const _Arrange_Lesson &lesson=List[Order_List[j][state.k[j]]];
+                state.occupied.merge(lesson.words);
+                for (int l=0;l<lesson.cells.size();l++) state.owner[lesson.cells[l]]=j;
+                ARRANGE_STAT(state.stats.node[j]++);
+                if (j==state.ceil-1)
+                {
+                    for (int d=j;d>=state.floor&&!state.found[d];d--) state.found[d]=true; //某层找到过解时其上各层也必然找到过
+                    ARRANGE_STAT(state.stats.solution++);
+                    return true;
+                }
+                j++;
+                enterdepth(state,j);
+            }
+            return false;
+        }
+
+        //内部函数：撤销第j层所选课程的占用
+        void unsetlesson(_Search_State &state,int j)
+        {
+            const _Arrange_Lesson &lesson=List[Order_List[j][state.k[j]]];
+            state.occupied.remove(lesson.words);
+        }
+
+        //内部函数：生成课程表, 每得到一张课程表即交给visitor
+        //与迭代器相同, 在整个搜索顺序上回溯, 不预先保存任何连通分量的解, visitor提前结束时不再继续搜索
+        template<typename Visitor>bool arrangelesson(vector<_Table>Table_temp,Visitor &visitor)
+        {
+            bool failed=true;
+            _Search_State state;
+            vector<int>e;
+            const vector<_Table>&Table_view=Table_temp; //visitor只能读取课程表
+            resetstate(state);
+            while (branch(state))
+            {
+                e.assign(amount_course,0);
+                do //展开各层的等价类
+                {
+                    filltable(Table_temp,state.k,e);
+                    failed=false;
+                    ARRANGE_STAT(state.stats.table++);
+                    bool if_next=visitor(Table_view);
+                    cleartable(Table_temp,state.k,e);
+                    if (!if_next)
                     {
-                        Table_temp.assign(Table_Temp_bak.begin(),Table_Temp_bak.end());
-                        break;
+                        ARRANGE_STAT(Stats.merge(state.stats));
+                        return true;
                     }
+                } while (nextequal(state.k,e));
+            }
+            ARRANGE_STAT(Stats.merge(state.stats));
+            return !failed;
+        }
+
+        //内部函数：将k与e对应的课程按课程大纲的顺序填入课程表, 与buildtable的结果相同
+        void filltable(vector<_Table>&Table_temp,const vector<int>&k,const vector<int>&e)
+        {
+            for (int i=0;i<amount_course;i++)
+            {
+                int j=Course_depth[i];
+                puttable(Table_temp,Equal_List[Order_List[j][k[j]]][e[j]]);
+            }
+        }
+
+        //内部函数：将第List_number门课程填入课程表, 所在的节已有其他课程(只能是在其他周次上课)时在各节之后记入附加项
+        void puttable(vector<_Table>&Table_temp,int List_number)
+        {
+            const _Arrange_Lesson &lesson=List[List_number];
+            for (int l=0;l<lesson.time.size();l++)
+            {
+                if (lesson.time[l]<0||lesson.time[l]>=Table_size) continue;
+                _Table &cell=Table_temp[lesson.time[l]];
+                if (cell.number==-1||cell.number==lesson.number)
+                {
+                    cell.number=lesson.number;
+                    cell.List_number=List_number;
+                    continue;
                 }
-                if (!k_i_failed)
+                _Table extra={lesson.number,lesson.time[l]};
+                int x=Table_size;
+                while (x<Table_temp.size()&&(Table_temp[x].number!=extra.number||Table_temp[x].List_number!=extra.List_number)) x++;
+                if (x==Table_temp.size()) Table_temp.push_back(extra);
+            }
+        }
+
+        //内部函数：将k与e对应的课程从课程表中清除, 恢复为初始课程表
+        void cleartable(vector<_Table>&Table_temp,const vector<int>&k,const vector<int>&e)
+        {
+            for (int i=0;i<amount_course;i++)
+            {
+                const _Arrange_Lesson &lesson=List[Equal_List[Order_List[i][k[i]]][e[i]]];
+                for (int l=0;l<lesson.time.size();l++)
                 {
-                    //将缓存压入Table中
-                    Table.push_back(Table_temp);
-                    Table_temp.assign(Table_Temp_bak.begin(),Table_Temp_bak.end());
-                    failed=false;
+                    Table_temp[lesson.time[l]]=Table_default[lesson.time[l]];
                 }
             }
-            return !failed;
+            Table_temp.resize(Table_size); //去掉附加项, 不释放空间
+        }
+
+
+        //内部函数：生成Rest_mask
+        void setRest_mask(void)
+        {
+            Rest_mask.resize(amount_course+1);
+            Rest_mask[amount_course].clear();
+            for (int j=amount_course-1;j>=0;j--)
+            {
+                Rest_mask[j]=Rest_mask[j+1];
+                for (int k=0;k<Order_List[j].size();k++) Rest_mask[j].merge(List[Order_List[j][k]].mask);
+            }
+        }
+
+        //内部函数：记忆化计数, 给出占用状态为occupied时从第j项课程大纲开始的课程表数量
+        unsigned long long countbranch(int j,const _Mask &occupied)
+        {
+            if (j==amount_course) return 1;
+            typename map<_Mask,unsigned long long>::iterator it=Count_memo[j].find(occupied);
+            if (it!=Count_memo[j].end())
+            {
+                ARRANGE_STAT(Stats.memo++);
+                return it->second;
+            }
+            unsigned long long sum=0;
+            for (int k=0;k<Order_List[j].size();k++)
+            {
+                const _Arrange_Lesson &lesson=List[Order_List[j][k]];
+                if (lesson.self_conflict||occupied.intersect(lesson.words)) continue;
+                ARRANGE_STAT(Stats.node[j]++);
+                _Mask next=occupied;
+                next.merge(lesson.words);
+                next.restrict(Rest_mask[j+1]); //只保留后续课程可能用到的时间, 使不同的占用状态得以合并
+                sum+=countbranch(j+1,next)*Equal_List[Order_List[j][k]].size(); //等价类中的每门课程各得到一组课程表
+            }
+            Count_memo[j][occupied]=sum;
+            return sum;
+        }
+
+        //内部函数：由seed生成[0,range)内的均匀随机数并更新seed, 使用splitmix64, 各平台结果一致
+        unsigned long long getrandom(unsigned long long &seed,unsigned long long range)
+        {
+            unsigned long long limit=(0-range)%range; //丢弃小于2^64 mod range的数, 避免取模带来的偏差
+            while (true)
+            {
+                unsigned long long z=(seed+=0x9E3779B97F4A7C15ULL);
+                z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+                z=(z^(z>>27))*0x94D049BB133111EBULL;
+                z^=z>>31;
+                if (z>=limit) return z%range;
+            }
+        }
+
+        //内部类：getbest中的一张候选课程表, 按分数与找到的先后排序
+        struct _Best_Table
+        {
+            long long score;
+            long long found; //找到的先后, 分数相同时先找到的优先
+            vector<int>k,e;
+            bool operator<(const _Best_Table &other) const
+            {
+                return score!=other.score?score<other.score:found<other.found;
+            }
+        };
+        //内部类：getbest的搜索状态
+        struct _Best_State
+        {
+            const _Score_Model &model;
+            int amount_best;
+            long long found;
+            vector<long long>lesson_cost; //每门课程可累加的分数: 第1、2节课与额外扣分; 对等价类的代表, 为等价类中最低的分数
+            vector<long long>equal_cost; //每门课程本身可累加的分数, 等价类中各门课程只有额外扣分可能不同
+            vector<unsigned long long>lesson_day; //每门课程占用的日子, 第d位对应第d天, 第t段学期从第t*Calendar::days位开始
+            vector<_Cell_Mask>lesson_time; //每门课程在课程表中的各节
+            vector<_Cell_Mask>rest_time; //rest_time[j]为第j层及之后的课程可能占用的各节, 其外的空闲节次之后无法填入
+            vector<long long>rest_cost; //rest_cost[j]为第j层及之后每层最低可累加分数之和, 为-1时表示无解
+            vector<vector<int> >by_cost; //每层课程按可累加分数由低到高的顺序
+            vector<int>k;
+            _Mask occupied; //初始课程表与当前各层所选课程占用的时间
+            vector<long long>cost; //cost[j]为前j层的可累加分数
+            vector<unsigned long long>day; //day[j]为前j层占用的日子
+            vector<_Cell_Mask>chosen; //chosen[j]为前j层所选课程在课程表中的各节
+            std::priority_queue<_Best_Table>best; //当前最好的课程表, 堆顶为其中最差的
+            _Best_State(const _Score_Model &input_model,int input_amount):model(input_model),amount_best(input_amount),found(0) { }
+        };
+
+        //内部函数：生成getbest所需的每门课程的分数与分数下界
+        void setbest(_Best_State &state)
+        {
+            _Cell_Mask empty;
+            empty.clear();
+            state.lesson_cost.assign(amount_lesson,0);
+            state.lesson_day.assign(amount_lesson,0);
+            state.lesson_time.assign(amount_lesson,empty);
+            vector<int>time;
+            for (int i=0;i<amount_lesson;i++)
+            {
+                //同一门课程的几行可能在不同周次占用同一节, 每节只计一次
+                time.assign(List[i].time.begin(),List[i].time.end());
+                std::sort(time.begin(),time.end());
+                time.erase(std::unique(time.begin(),time.end()),time.end());
+                for (int l=0;l<time.size();l++)
+                {
+                    if (time[l]%Calendar::periods<2) state.lesson_cost[i]+=state.model.early_weight;
+                    state.lesson_day[i]|=1ULL<<(time[l]/Calendar::periods);
+                    state.lesson_time[i].set(time[l]);
+                }
+                map<int,int>::const_iterator it=state.model.lesson_penalty.find(List[i].number);
+                if (it!=state.model.lesson_penalty.end()) state.lesson_cost[i]+=it->second;
+            }
+            state.equal_cost=state.lesson_cost;
+            for (int i=0;i<amount_lesson;i++)
+            {
+                for (int m=1;m<Equal_List[i].size();m++) state.lesson_cost[i]=std::min(state.lesson_cost[i],state.equal_cost[Equal_List[i][m]]);
+            }
+            state.rest_cost.assign(amount_course+1,0);
+            state.rest_time.assign(amount_course+1,empty);
+            state.by_cost.resize(amount_course);
+            for (int j=amount_course-1;j>=0;j--)
+            {
+                long long min_cost=-1;
+                state.by_cost[j].clear();
+                state.rest_time[j]=state.rest_time[j+1];
+                for (int k=0;k<Order_List[j].size();k++)
+                {
+                    const _Arrange_Lesson &lesson=List[Order_List[j][k]];
+                    if (lesson.self_conflict||lesson.mask.intersect(Block_mask)) continue;
+                    state.by_cost[j].push_back(k);
+                    state.rest_time[j].merge(state.lesson_time[Order_List[j][k]]); //等价类中各门课程的时间相同
+                    if (min_cost<0||state.lesson_cost[Order_List[j][k]]<min_cost) min_cost=state.lesson_cost[Order_List[j][k]];
+                }
+                std::stable_sort(state.by_cost[j].begin(),state.by_cost[j].end(),_Order_Cost_Less(state.lesson_cost,Order_List[j]));
+                state.rest_cost[j]=(min_cost<0||state.rest_cost[j+1]<0)?-1:min_cost+state.rest_cost[j+1];
+            }
+        }
+
+        //内部类：按可累加分数比较第j层的课程
+        struct _Order_Cost_Less
+        {
+            const vector<long long>&lesson_cost;
+            const vector<int>&order;
+            _Order_Cost_Less(const vector<long long>&input_cost,const vector<int>&input_order):lesson_cost(input_cost),order(input_order) { }
+            bool operator()(int a,int b) const
+            {
+                return lesson_cost[order[a]]<lesson_cost[order[b]];
+            }
+        };
+
+        //内部函数：计算一张完整课程表的分数
+        long long bestscore(const _Best_State &state)
+        {
+            int days=0;
+            for (unsigned long long d=state.day[amount_course];d;d&=d-1) days++;
+            return state.cost[amount_course]+(long long)state.model.day_weight*days+(long long)state.model.gap_weight*bestgap(state,amount_course);
+        }
+
+        //内部函数：前j层所选课程在每天第一节与最后一节课之间留下的空闲节次中, 之后各层都无法填入的节数
+        //之后的课程只能填入空闲节次或延长当天的首尾, 因此这是最终空闲节数的下界, j为amount_course时即为空闲节数
+        int bestgap(const _Best_State &state,int j)
+        {
+            int gap=0;
+            const _Cell_Mask &chosen=state.chosen[j];
+            for (int d=0;d<Calendar::days*Calendar::terms;d++)
+            {
+                int first=-1,last=-1;
+                for (int t=0;t<Calendar::periods;t++)
+                {
+                    if (!chosen.test(d*Calendar::periods+t)) continue;
+                    if (first<0) first=t;
+                    last=t;
+                }
+                for (int t=first+1;t<last;t++)
+                {
+                    int time=d*Calendar::periods+t;
+                    if (!chosen.test(time)&&!state.rest_time[j].test(time)) gap++;
+                }
+            }
+            return gap;
+        }
+
+        //内部函数：分支定界, 分数下界为已选课程的可累加分数、已占用的日子、之后每层最低可累加分数与无法再填入的空闲节次之和
+        void bestbranch(int j,_Best_State &state)
+        {
+            if (j==amount_course)
+            {
+                //展开各层的等价类, 各种展开方式只有额外扣分不同
+                ARRANGE_STAT(Stats.solution++);
+                long long base=bestscore(state)-state.cost[amount_course];
+                vector<int>e(amount_course,0);
+                do
+                {
+                    _Best_Table candidate;
+                    candidate.score=base;
+                    for (int i=0;i<amount_course;i++) candidate.score+=state.equal_cost[Equal_List[Order_List[i][state.k[i]]][e[i]]];
+                    candidate.found=state.found++;
+                    if (state.best.size()<state.amount_best||candidate<state.best.top())
+                    {
+                        candidate.k=state.k;
+                        candidate.e=e;
+                        state.best.push(candidate);
+                        if (state.best.size()>state.amount_best) state.best.pop();
+                    }
+                } while (nextequal(state.k,e));
+                return;
+            }
+            for (int i=0;i<state.by_cost[j].size();i++)
+            {
+                state.k[j]=state.by_cost[j][i];
+                const _Arrange_Lesson &lesson=List[Order_List[j][state.k[j]]];
+                if (state.occupied.intersect(lesson.words)) continue;
+                state.cost[j+1]=state.cost[j]+state.lesson_cost[Order_List[j][state.k[j]]];
+                state.day[j+1]=state.day[j]|state.lesson_day[Order_List[j][state.k[j]]];
+                int days=0;
+                for (unsigned long long d=state.day[j+1];d;d&=d-1) days++;
+                long long bound=state.cost[j+1]+state.rest_cost[j+1]+(long long)state.model.day_weight*days;
+                bool if_full=state.best.size()==state.amount_best;
+                if (if_full&&bound>=state.best.top().score)
+                {
+                    ARRANGE_STAT(Stats.bound++);
+                    continue;
+                }
+                state.chosen[j+1]=state.chosen[j];
+                state.chosen[j+1].merge(state.lesson_time[Order_List[j][state.k[j]]]);
+                if (if_full&&state.model.gap_weight>0&&bound+(long long)state.model.gap_weight*bestgap(state,j+1)>=state.best.top().score) //空闲节次的下界计算较慢, 其余部分不足以剪枝时才计算
+                {
+                    ARRANGE_STAT(Stats.bound++);
+                    continue;
+                }
+                ARRANGE_STAT(Stats.node[j]++);
+                state.occupied.merge(lesson.words);
+                bestbranch(j+1,state);
+                state.occupied.remove(lesson.words);
+            }
+        }
+
+        //内部函数：初始化搜索状态, 初始占用为初始课程表中的非空时间
+        void resetstate(_Search_State &state)
+        {
+            state.started=false;
+            state.floor=0;
+            state.ceil=amount_course;
+            state.k.assign(amount_course,-1);
+            state.occupied=Block_mask;
+            state.owner.assign(Calendar::size,-1);
+            state.conflict.assign(amount_course*Depth_words,0);
+            state.found.assign(amount_course,false);
+            state.nogood.clear();
+            state.amount_nogood=0;
+            ARRANGE_STAT(state.stats=_Arrange_Stats());
+            ARRANGE_STAT(state.stats.node.assign(amount_course,0));
+        }
+
+        //内部类：各连通分量的解的惰性笛卡尔积
+        struct _Product_State
+        {
+            bool started;
+            vector<Solution_Store>part; //part[c]为第c个连通分量的所有解, 每个解为该分量各层的k
+            vector<int>index; //当前组合中各分量所取的解
+            vector<int>slice; //取出的单个分量的解
+        };
+
+        //内部函数：分别遍历每个连通分量, 某个分量无解时之后的分量不必再遍历
+        void setproduct(_Product_State &product)
+        {
+            product.started=false;
+            product.part.assign(amount_component,Solution_Store());
+            _Search_State state;
+            for (int c=0;c<amount_component;c++)
+            {
+                int max_size=0;
+                for (int j=Component_begin[c];j<Component_begin[c+1];j++) if (Order_List[j].size()>max_size) max_size=Order_List[j].size();
+                product.part[c].reset(Component_begin[c+1]-Component_begin[c],max_size);
+                resetstate(state);
+                state.floor=Component_begin[c];
+                state.ceil=Component_begin[c+1];
+                while (branch(state))
+                {
+                    product.slice.assign(state.k.begin()+state.floor,state.k.begin()+state.ceil);
+                    product.part[c].push(product.slice);
+                }
+                ARRANGE_STAT(Stats.merge(state.stats));
+                if (product.part[c].size()==0) break;
+            }
+        }
+
+        //内部函数：给出笛卡尔积中的下一组k, 第一个分量变化最慢, 因而与直接回溯的顺序相同
+        bool nextproduct(_Product_State &product,vector<int>&k)
+        {
+            int c;
+            if (!product.started)
+            {
+                product.started=true;
+                if (amount_component==0) return false; //没有课程大纲时无解
+                for (c=0;c<amount_component;c++) if (product.part[c].size()==0) return false;
+                product.index.assign(amount_component,0);
+                k.assign(amount_course,0);
+                c=0;
+            }
+            else
+            {
+                for (c=amount_component-1;c>=0;c--)
+                {
+                    if (++product.index[c]<product.part[c].size()) break;
+                    product.index[c]=0;
+                }
+                if (c<0) return false;
+            }
+            //只需重新取出第c个及之后的分量
+            for (;c<amount_component;c++)
+            {
+                product.part[c].get(product.index[c],product.slice);
+                std::copy(product.slice.begin(),product.slice.end(),k.begin()+Component_begin[c]);
+            }
+            return true;
+        }
+
+        //内部函数：将搜索树按前floor项课程大纲的选择分为子树, 逐层加深直至子树数量不少于amount_subtree
+        void setsubtree(vector<_Search_State>&subtree,int amount_subtree)
+        {
+            vector<_Search_State>subtree_next;
+            subtree.resize(1);
+            resetstate(subtree[0]);
+            for (int j=0;j<amount_course&&subtree.size()<amount_subtree;j++)
+            {
+                subtree_next.clear();
+                for (int t=0;t<subtree.size();t++)
+                {
+                    for (subtree[t].k[j]=0;subtree[t].k[j]<Order_List[j].size();subtree[t].k[j]++)
+                    {
+                        if (if_continue(subtree[t],j)) continue;
+                        subtree_next.push_back(subtree[t]);
+                        subtree_next.back().floor=j+1;
+                        subtree_next.back().occupied.merge(List[Order_List[j][subtree[t].k[j]]].mask);
+                    }
+                }
+                subtree.swap(subtree_next);
+            }
         }
             
         //测试函数：输出vector<int>
@@ -353,4 +1901,253 @@ class Arrange
         
 };
 
+//默认日历的Arrange类
+typedef Arrange_T<_Calendar_default> Arrange;
+
+//Arrange_Stage缓存的选修课课程表总数上限, 超过时清空缓存, 之后遇到的占用重新搜索
+//缓存最多占用约STAGE_CACHE_LIMIT*选修课大纲数*序号字节数, 再加上最后一次搜索的结果
+#define STAGE_CACHE_LIMIT (1<<20)
+
+//Arrange_Stage类，分阶段安排课程: 先安排必修课, 再对必修课的每张课程表在其余下的时间中安排选修课
+//选修课的课程表按必修课占用的时间缓存, 多张必修课课程表占用相同时只搜索一次选修课
+template<typename Calendar>
+class Arrange_Stage_T
+{
+    public:
+        typedef typename Arrange_T<Calendar>::_Mask _Mask;
+
+        //构造函数，输入必修课的起始位与终末位, 选修课的起始位与终末位, 以及课程表大小
+        Arrange_Stage_T(int a,int b,int c,int d,int size=Calendar::size):Required(a,b,size),Elective(c,d,size)
+        {
+            Table_size=size;
+            amount_table=0;
+            amount_search=0;
+            cache_table=0;
+        }
+
+        //对外接口：输入课程信息, 必修课与选修课分别取各自的起始位至终末位
+        void setlesson(_Lesson input[])
+        {
+            Required.setlesson(input);
+            Elective.setlesson(input);
+            clearcache();
+        }
+
+        //对外接口：设置两个阶段的搜索顺序
+        void setorder(int course_order,int lesson_order=ORDER_INPUT)
+        {
+            Required.setorder(course_order,lesson_order);
+            Elective.setorder(course_order,lesson_order);
+            clearcache();
+        }
+
+        //对外接口：输入初始课程表, 两个阶段共用
+        void settable(const vector<_Table>domain_Table)
+        {
+            Required.settable(domain_Table);
+            Elective.settable(domain_Table);
+            clearcache();
+        }
+
+        //对外接口：输出课程表
+        bool gettable(vector<vector<_Table> >&codomain_Table)
+        {
+            codomain_Table.clear();
+            _Table_Collector collector={&codomain_Table};
+            return enumerate(collector);
+        }
+
+        //对外接口：以紧凑形式输出课程表, 每张课程表保存必修课与选修课所选课程的序号, 需要时由buildtable生成
+        bool gettable(Solution_Store &codomain_Solution)
+        {
+            bool failed=true;
+            _Mask cover,mask;
+            vector<int>choice,elective_choice;
+            const int amount_required=Required.getcourse();
+            codomain_Solution.reset(amount_required+Elective.getcourse(),std::max(Required.getwidth(),Elective.getwidth()));
+            amount_table=0;
+            if (amount_required==0||Elective.getcourse()==0) //只有一个阶段有课程大纲时按单个阶段排课, 另一阶段不占序号
+            {
+                Arrange_T<Calendar> &single=amount_required>0?Required:Elective;
+                mask.clear();
+                Elective.setblock(mask);
+                for (typename Arrange_T<Calendar>::iterator it=single.begin();it!=single.end();++it)
+                {
+                    it.getindex(choice);
+                    codomain_Solution.push(choice);
+                    failed=false;
+                }
+                amount_table=codomain_Solution.size();
+                return !failed;
+            }
+            Elective.getcover(cover);
+            for (typename Arrange_T<Calendar>::iterator it=Required.begin();it!=Required.end();++it)
+            {
+                it.getmask(mask);
+                mask.restrict(cover);
+                const Solution_Store &solution=getelective(mask);
+                it.getindex(choice);
+                for (int i=0;i<solution.size();i++)
+                {
+                    solution.get(i,elective_choice);
+                    choice.resize(amount_required);
+                    choice.insert(choice.end(),elective_choice.begin(),elective_choice.end());
+                    codomain_Solution.push(choice);
+                    failed=false;
+                }
+            }
+            amount_table=codomain_Solution.size();
+            return !failed;
+        }
+
+        //对外接口：由紧凑形式生成第index张课程表, 与enumerate得到的课程表相同
+        void buildtable(const Solution_Store &domain_Solution,int index,vector<_Table>&codomain_Table)
+        {
+            vector<int>choice,elective_choice;
+            vector<_Table>elective_table;
+            domain_Solution.get(index,choice);
+            elective_choice.assign(choice.begin()+Required.getcourse(),choice.end());
+            choice.resize(Required.getcourse());
+            Required.buildtable(choice,codomain_Table);
+            Elective.buildtable(elective_choice,elective_table);
+            mergetable(codomain_Table,elective_table);
+        }
+
+        //对外接口：逐张枚举课程表, 不保存结果, visitor的用法与Arrange::enumerate相同
+        //必修课的课程表由Arrange::iterator逐张生成, 每张只在其占用未出现过时才搜索选修课
+        template<typename Visitor>bool enumerate(Visitor visitor)
+        {
+            bool failed=true;
+            _Mask cover,mask;
+            vector<_Table>table,elective_table;
+            const vector<_Table>&Table_view=table; //visitor只能读取课程表
+            amount_table=0;
+            if (Required.getcourse()==0||Elective.getcourse()==0) //只有一个阶段有课程大纲时按单个阶段排课, 都没有时无解
+            {
+                Arrange_T<Calendar> &single=Required.getcourse()>0?Required:Elective;
+                mask.clear();
+                Elective.setblock(mask);
+                for (typename Arrange_T<Calendar>::iterator it=single.begin();it!=single.end();++it)
+                {
+                    amount_table++;
+                    failed=false;
+                    if (!visitor(*it)) return true;
+                }
+                return !failed;
+            }
+            Elective.getcover(cover);
+            for (typename Arrange_T<Calendar>::iterator it=Required.begin();it!=Required.end();++it)
+            {
+                it.getmask(mask);
+                mask.restrict(cover); //选修课不可能占用的时间不影响选修课的课程表, 不计入缓存的键
+                const Solution_Store &solution=getelective(mask);
+                for (int i=0;i<solution.size();i++)
+                {
+                    table.assign(it->begin(),it->end());
+                    Elective.buildtable(solution,i,elective_table);
+                    mergetable(table,elective_table);
+                    amount_table++;
+                    failed=false;
+                    if (!visitor(Table_view)) return true;
+                }
+            }
+            return !failed;
+        }
+
+        //对外接口：上一次gettable或enumerate得到的课程表数量
+        unsigned long long getamount(void)
+        {
+            return amount_table;
+        }
+
+        //对外接口：以JSON格式输出两个阶段的搜索统计, 只在定义ARRANGE_STATS时累加
+        void getstats(std::string &json) const
+        {
+            std::string required,elective;
+            Required.getstats(required);
+            Elective.getstats(elective);
+            json="{\"required\":"+required+",\"elective\":"+elective+"}";
+        }
+
+        //对外接口：清零两个阶段的搜索统计
+        void clearstats(void)
+        {
+            Required.clearstats();
+            Elective.clearstats();
+        }
+
+        //对外接口：选修课的搜索次数, 缓存未被清空时即必修课课程表中不同占用的个数
+        int getcache(void)
+        {
+            return amount_search;
+        }
+
+    private:
+        Arrange_T<Calendar> Required,Elective; //必修课与选修课
+        map<_Mask,Solution_Store>Elective_cache; //按必修课占用的时间缓存的选修课课程表
+        unsigned long long amount_table; //上一次得到的课程表数量
+        int amount_search; //缓存清空后选修课的搜索次数
+        unsigned long long cache_table; //缓存中选修课课程表的总数, 超过STAGE_CACHE_LIMIT时清空
+        int Table_size; //课程表大小, 其后为附加项
+
+        //内部类：将课程表存入动态数组的visitor
+        struct _Table_Collector
+        {
+            vector<vector<_Table> >*codomain;
+            bool operator()(const vector<_Table>&table)
+            {
+                codomain->push_back(table);
+                return true;
+            }
+        };
+
+        //内部函数：必修课占用mask时的选修课课程表, 未缓存时才搜索
+        //缓存已满时先清空, 此前返回的引用随之失效, 调用者只使用最近一次的结果
+        const Solution_Store &getelective(const _Mask &mask)
+        {
+            typename map<_Mask,Solution_Store>::iterator found=Elective_cache.find(mask);
+            if (found==Elective_cache.end())
+            {
+                if (cache_table>=STAGE_CACHE_LIMIT)
+                {
+                    Elective_cache.clear();
+                    cache_table=0;
+                }
+                found=Elective_cache.insert(std::make_pair(mask,Solution_Store())).first;
+                Elective.setblock(mask);
+                Elective.gettable(found->second);
+                cache_table+=found->second.size();
+                amount_search++;
+            }
+            return found->second;
+        }
+
+        //内部函数：清空选修课的缓存, 课程大纲、搜索顺序或初始课程表改变时调用
+        void clearcache(void)
+        {
+            Elective_cache.clear();
+            cache_table=0;
+            amount_search=0;
+        }
+
+        //内部函数：将选修课的课程表并入必修课的课程表
+        //必修课在前, 选修课在不同周次共用的节记为附加项, 选修课自身的附加项接在其后
+        void mergetable(vector<_Table>&table,const vector<_Table>&elective_table)
+        {
+            for (int x=0;x<Table_size;x++)
+            {
+                if (table[x].number==-1) table[x]=elective_table[x];else
+                if (elective_table[x].number!=-1&&elective_table[x].number!=table[x].number)
+                {
+                    _Table extra={elective_table[x].number,x};
+                    table.push_back(extra);
+                }
+            }
+            table.insert(table.end(),elective_table.begin()+Table_size,elective_table.end());
+        }
+};
+
+//默认日历的Arrange_Stage类
+typedef Arrange_Stage_T<_Calendar_default> Arrange_Stage;
+
 #endif
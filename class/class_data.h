@@ -12,6 +12,7 @@
 #include<cstdio>
 #include<cstdlib>
 #include<cstring>
+#include<algorithm>
 #include<iostream>
 #include<string>
 #include<vector>
@@ -25,22 +26,27 @@ using std::endl;
 using std::vector;
 #endif
 
-//全局总课表
+//全局总课表, 字符串字段直接指向input_Curriculum映射的文件内容
 struct _Curriculum
 {
-	char num[5];	//选课序号
-	char class_name[40];	//课程名称
-	char teacher_name[40];	//教师姓名 
-	char week[10];	//星期
-	char course_duration[10];	//课程节次
-	char course_week[20];	//起止周次
-	char address[100];	//教室
+	char *num;	//选课序号
+	char *class_name;	//课程名称
+	char *teacher_name;	//教师姓名 
+	char *week;	//星期
+	char *course_duration;	//课程节次
+	char *course_week;	//起止周次
+	char *address;	//教室
+	int number;	//选课序号, 即F1(num)
+	int day;	//星期, 即F2(week)
+	int period_first;	//起始节次, 即F3(course_duration)
+	int period_last;	//终止节次, 即F4(course_duration)
+	unsigned int weeks;	//上课的周次, 即F7(course_week)
 };
 
 //全局用户输入课程数据 
 struct _Syllabus
 {
-	char num[5];	//选课序号 
+	char num[10];	//选课序号, 也可以是"elective"或"break" 
 	char class_name[40];	//课程名称 
 	char teacher_name[40];  //教师姓名 
 };
@@ -53,13 +59,122 @@ struct _Lesson
 	int t_week; //周次
 	vector<int>t_time; //课程时间, 不计周次
     vector<int>time; //课程时间
+    vector<int>week_time; //按周次的课程时间, 为空时视为在time所在学期段的每一周都有课
 };
 
 //全局课程表
+//课程表的前Table_size项为各节; 不同周次上课的课程可以共用一节, 第一门按课程大纲的顺序记入该节,
+//其余依次作为附加项接在各节之后, 附加项的number为选课序号, List_number为所共用的节, 通常没有附加项
 struct _Table
 {
     int number; //选课序号
     int List_number; //课程编码
 };
 
+//课程表的日历格式: 每天的节数, 每周的天数, 每学期分为几段(如上下半学期), 每学期的周数
+//课程表中第term段星期day第period节(均从0开始)的位置为term*term_size+day*periods+period
+//按周次的占用中第week周(从0开始)的时间slot=day*periods+period位于slot*weeks+week, 同一节各周的位相邻
+template<int Periods,int Days,int Terms,int Weeks>
+struct _Calendar
+{
+    enum
+    {
+        periods=Periods, //每天的节数
+        days=Days, //每周的天数
+        terms=Terms, //学期的段数
+        weeks=Weeks, //学期的周数
+        term_size=Periods*Days, //每段的节数
+        size=Periods*Days*Terms, //课程表的大小
+        week_size=Periods*Days*Weeks, //按周次的占用大小
+        term_weeks=Weeks/Terms>0?Weeks/Terms:1 //每段的周数, 最后一段包含剩余的周
+    };
+    //第week周(从0开始)所在的学期段
+    static int term(int week)
+    {
+        return week/term_weeks<Terms?week/term_weeks:Terms-1;
+    }
+};
+
+//默认日历: 每天14节, 每周7天, 分上下半学期(第1~8周与第9~17周), 共17周
+typedef _Calendar<14,7,2,17> _Calendar_default;
+
+//紧凑的课程表集合, 每张课程表只保存每项课程大纲所选课程的序号(通常每项1字节), 需要时由Arrange::buildtable生成课程表
+class Solution_Store
+{
+    public:
+        Solution_Store()
+        {
+            amount_course=0;
+            bytes=1;
+            amount=0;
+        }
+
+        //设置每张课程表的课程大纲数与序号的最大值(不含), 并清空
+        void reset(int course,int max_index)
+        {
+            amount_course=course;
+            bytes=1;
+            while (bytes<4&&max_index>(1<<(8*bytes))) bytes++; //序号超过一字节时加宽
+            amount=0;
+            data.clear();
+        }
+
+        //存入一张课程表, choice[i]为第i项课程大纲所选课程的序号
+        void push(const vector<int>&choice)
+        {
+            for (int i=0;i<amount_course;i++)
+            {
+                for (int b=0;b<bytes;b++) data.push_back((unsigned char)(choice[i]>>(8*b)));
+            }
+            amount++;
+        }
+
+        //取出第index张课程表
+        void get(int index,vector<int>&choice) const
+        {
+            choice.assign(amount_course,0);
+            if (amount_course==0) return; //没有课程大纲时data为空
+            const unsigned char *p=&data[0]+(size_t)index*amount_course*bytes;
+            for (int i=0;i<amount_course;i++)
+            {
+                for (int b=0;b<bytes;b++) choice[i]|=(int)p[i*bytes+b]<<(8*b);
+            }
+        }
+
+        //在末尾接上格式相同的另一个集合
+        void append(const Solution_Store &other)
+        {
+            data.insert(data.end(),other.data.begin(),other.data.end());
+            amount+=other.amount;
+        }
+
+        void swap(Solution_Store &other)
+        {
+            std::swap(amount_course,other.amount_course);
+            std::swap(bytes,other.bytes);
+            std::swap(amount,other.amount);
+            data.swap(other.data);
+        }
+
+        int size(void) const
+        {
+            return amount;
+        }
+
+    private:
+        int amount_course; //每张课程表的课程大纲数
+        int bytes; //每个序号占用的字节数
+        int amount; //课程表数量
+        vector<unsigned char>data; //依次存放各张课程表的序号
+};
+
+//单个用户的选课会话, 取代原先的全局变量, 使多个用户可在不同线程中同时排课
+struct _Session
+{
+	int flat;	//用户输入课程数据的条数
+	int elective;	//用户输入课程数据中选修课的起始条数, -1表示不区分必修课与选修课
+	int elective_lesson;	//课程信息中选修课的起始位, -1表示不区分必修课与选修课
+	Solution_Store class_Table;	//输出的课程表, 以紧凑形式保存
+};
+
 #endif
@@ -8,14 +8,23 @@
  * 
  *********************************************************/
 
+#include<cctype>
 #include<cstdio>
 #include<cstdlib>
 #include<cstring>
+#include<algorithm>
+#include<iterator>
+#include<map>
+#include<string>
 #include<vector>
 #include<iomanip>
+#if __cplusplus >= 201103L
+#include<unordered_map>
+#endif
 
 #include"class_data.h"
 #include"class_arrg.h"
+#include"class_map.h"
 
 #ifndef CLASS_INPUT
 #define CLASS_INPUT
@@ -30,110 +39,488 @@ using namespace std;
  * 考虑到全程没有引入其他命名空间, 直接using namespace std;
  * 读取文件时, 默认文件与主程序位于同一目录下, 添加了错误暂停
  * 输入文件分别改名为Curriculum.txt和Syllabus.txt
+ * 全局变量全部转移到_Session中, 总课表只读, 可供多个线程共享
+ * delivery与output_table按日历格式模板化, 不带模板参数时使用默认日历
+ * 起止周次由F7解析为周次掩码, 上下半学期由周次决定, 冲突按周精确判断
+ * 星期或节次超出日历的课程在delivery中跳过, 不会写到课程表之外
+ * 在不同周次共用一节的课程都会输出, 以'/'分隔
+ * 文件无法打开时录入函数返回错误而不结束程序, 一个会话的错误不影响同一进程中的其他会话
+ * Syllabus.txt中"elective NULL NULL"一行之后为选修课, 由Arrange_Stage分阶段排课
+ * 选课数据按整行读入后切分, 字段过长的行提示后跳过, 不再被定长的fscanf截断而错位
+ * 总课表改为映射到内存后原地切分, 不再逐行fscanf, 字段不再受定长数组限制, 数值字段读入时一并解析
+ * 总课表, 选课数据与课程信息改用vector, 先统计行数再一次分配, 不再受N=2201等固定大小限制
+ * compile_Curriculum把总课表编译为二进制文件, 之后由input_Curriculum_compiled直接映射, 启动时不再解析文本
+ * 二进制总课表记录了文本总课表的大小与修改时间, 两者不符时改为读取文本总课表, 重新编译后才再次使用
+ * index_Curriculum按选课序号与课程名称为总课表建立索引, delivery按索引查找, 不再逐行比较
+ * 索引为按选课序号与课程名称排序的行号, 二分查找; 二进制总课表中保存排好的行号, 映射后直接取用, 启动时不再建立索引
+ * 输出课表时由索引按选课序号直接找到课程名称, 名称宽度在建立索引时一并算好
+ * 超过4位数字的选课序号不再按其大小分配数组, 改为二分查找; 数字字段只计入前9位, 不会溢出
  *********************************************************/
 
-#define N 2201 //八里台2201 津南1431 
-
-int flat;
-
-int number_lesson;
-
-vector<vector<_Table> >class_Table;
-
 #ifndef CLASS_DATA
 
 /************************
 		结构体部分 
 ************************/ 
-//课程原始数据 
+//课程原始数据, 字符串字段直接指向input_Curriculum映射的文件内容 
 struct _Curriculum
 {
-	char num[5];	//选课序号
-	char class_name[40];	//课程名称
-	char teacher_name[40];	//教师姓名 
-	char week[10];	//星期
-	char course_duration[10];	//课程节次
-	char course_week[20];	//起止周次
-	char address[100];	//教室
+	char *num;	//选课序号
+	char *class_name;	//课程名称
+	char *teacher_name;	//教师姓名 
+	char *week;	//星期
+	char *course_duration;	//课程节次
+	char *course_week;	//起止周次
+	char *address;	//教室
+	int number;	//选课序号, 即F1(num) 
+	int day;	//星期, 即F2(week) 
+	int period_first;	//起始节次, 即F3(course_duration) 
+	int period_last;	//终止节次, 即F4(course_duration) 
+	unsigned int weeks;	//上课的周次, 即F7(course_week) 
 };
 //用户输入课程数据 
 struct _Syllabus
 {
-	char num[5];	//选课序号 
+	char num[10];	//选课序号, 也可以是"elective"或"break" 
 	char class_name[40];	//课程名称 
 	char teacher_name[40];  //教师姓名 
 };
 #endif
 
+//二进制总课表的文件头, 文件依次为文件头, rows条记录, 按选课序号与按课程名称排序的rows个行号与字符串池, 均按本机字节序保存 
+#define CATALOG_MAGIC "CSOC"
+#define CATALOG_VERSION 3
+struct _Catalog_Header
+{
+	char magic[4];	//固定为CATALOG_MAGIC 
+	unsigned int version;	//格式版本, 与CATALOG_VERSION不同时不读取 
+	unsigned int order;	//固定为0x01020304, 用于识别字节序 
+	unsigned int rows;	//记录条数 
+	unsigned int pool_size;	//字符串池的字节数 
+	unsigned int reserved;	//保留, 为0, 使之后的字段8字节对齐 
+	unsigned long long source_size;	//编译时文本总课表的字节数 
+	long long source_time;	//编译时文本总课表的修改时间, 由stat_file给出 
+};
+//二进制总课表的一条记录, 字符串为在字符串池中的偏移, 相同的字符串只保存一次 
+struct _Catalog_Record
+{
+	unsigned int field[7];	//依次为选课序号, 课程名称, 教师姓名, 星期, 课程节次, 起止周次, 教室 
+	int number;
+	int day;
+	int period_first;
+	int period_last;
+	unsigned int weeks;
+};
+//总课表的索引, 由选课序号或课程名称二分查找总课表中的各行, 字段相同的各行按行号升序排列 
+#define CATALOG_ROW_DENSE 10000	//选课序号小于此值(至多4位数字)时由row直接查找, 否则在row_sparse中二分查找 
+struct _Catalog_Index
+{
+	vector<int>number;	//按选课序号排序的行号 
+	vector<int>name;	//按课程名称排序的行号 
+	vector<int>row;	//以选课序号(4位数字)为下标, 对应的第一行, 没有时为-1, 供输出课表时查找课程名称 
+	vector<pair<int,int> >row_sparse;	//超出4位数字的选课序号及其对应的第一行, 按选课序号排列 
+	vector<int>width;	//各行课程名称的显示宽度, GBK编码下即字节数 
+};
+
+//建立索引时字段的各个不同值的编号 
+#if __cplusplus >= 201103L
+typedef unordered_map<string,int> _Catalog_Group;
+#else
+typedef map<string,int> _Catalog_Group;
+#endif
+//总课表索引的比较函数, 按field所指的字段与字符串比较, 供二分查找 
+struct _Catalog_Less
+{
+	const vector<_Curriculum>*cl;
+	char *_Curriculum::*field;
+	bool operator()(int a,const char *key) const
+	{
+		return strcmp((*cl)[a].*field,key)<0;
+	}
+	bool operator()(const char *key,int b) const
+	{
+		return strcmp(key,(*cl)[b].*field)<0;
+	}
+};
+
 /************************** 
 下方为各部分函数的代码部分 
 **************************/
-//原始数据录入函数 
-void input_Curriculum(struct _Curriculum cl[])
+//数字字段解析函数, 从p开始读取连续的数字, p移到第一个非数字字符; 只计入前9位, 不会溢出 
+int parse_number(const char *&p)
+{
+	int sum=0;
+	for(;*p>='0'&&*p<='9';p++)
+	{
+		if(sum<100000000)sum=sum*10+(*p-48);
+	}
+	return(sum);
+}
+//原始数据录入函数, 总课表映射到内存后按制表符原地切分, 字符串字段直接指向映射的内容, 数值字段在同一遍中解析 
+//总课表在file关闭前有效, 先按换行符统计行数, 一次分配后读入, 返回读入的行数, 文件无法打开时返回-1 
+int input_Curriculum(vector<_Curriculum>&cl,Mapped_File &file,const char filename[]="Curriculum_balitai.txt")
+{
+	unsigned int F7(char str[]);
+	static char empty[1]={'\0'};
+	if(!file.open(filename))
+	{
+		printf("Can't open file: %s!\n",filename);
+		cl.clear();
+		return(-1);
+	}
+	char *p=file.data(),*end=p+file.size();	//非空时末尾总是'\n' 
+	int rows=0;
+	for(char *r=p;r<end;r++)
+	{
+		r=(char*)memchr(r,'\n',end-r);
+		rows++;
+	}
+	cl.clear();
+	cl.resize(rows);
+	int i=0;
+	while(p<end)
+	{
+		char *field[7];
+		int f=0;
+		field[f++]=p;
+		for(;*p!='\n';p++)
+		{
+			if(*p=='\t')
+			{
+				*p='\0';
+				if(f<7)field[f++]=p+1;	//多余的字段并入教室后被截去 
+			}
+			else if(*p=='\r')*p='\0';
+		}
+		*p++='\0';
+		if(field[0][0]=='\0')continue;	//跳过空行 
+		for(;f<7;f++)field[f]=empty;
+		cl[i].num=field[0];
+		cl[i].class_name=field[1];
+		cl[i].teacher_name=field[2];
+		cl[i].week=field[3];
+		cl[i].course_duration=field[4];
+		cl[i].course_week=field[5];
+		cl[i].address=field[6];
+		const char *q=cl[i].num;
+		cl[i].number=parse_number(q);
+		q=cl[i].week;
+		cl[i].day=parse_number(q);
+		q=cl[i].course_duration;
+		cl[i].period_first=parse_number(q);
+		cl[i].period_last=*q=='/'?parse_number(++q):cl[i].period_first;
+		cl[i].weeks=F7(cl[i].course_week);
+		i++;
+	}
+	cl.resize(i);	//去掉空行, 缩小时不重新分配 
+	return(i);
+}
+//字符串的比较函数, 供sort_Curriculum排序字段的不同值 
+struct _Key_Less
+{
+	const vector<const char*>*key;
+	bool operator()(int a,int b) const
+	{
+		return strcmp((*key)[a],(*key)[b])<0;
+	}
+};
+//总课表排序函数, 得到按field所指字段排序的行号, 字段相同时按行号升序 
+//先按字段值分组, 只对不同的值排序, 再按组的次序计数排序各行, 不对各行逐一比较字符串 
+void sort_Curriculum(const vector<_Curriculum>&cl,char *_Curriculum::*field,vector<int>&sorted)
+{
+	_Catalog_Group group;
+	vector<const char*>key;	//各组的字段值 
+	vector<int>row_group(cl.size());
+	for(int j=0;j<cl.size();j++)
+	{
+		pair<_Catalog_Group::iterator,bool>found=group.insert(make_pair(string(cl[j].*field),(int)key.size()));
+		if(found.second)key.push_back(cl[j].*field);
+		row_group[j]=found.first->second;
+	}
+	vector<int>order(key.size()),begin(key.size()+1,0);	//begin[g]为第g组在sorted中的起始位置 
+	for(int g=0;g<key.size();g++)order[g]=g;
+	_Key_Less less={&key};
+	sort(order.begin(),order.end(),less);
+	vector<int>rank(key.size());
+	for(int g=0;g<key.size();g++)rank[order[g]]=g;
+	for(int j=0;j<cl.size();j++)begin[rank[row_group[j]]+1]++;
+	for(int g=0;g<key.size();g++)begin[g+1]+=begin[g];
+	sorted.resize(cl.size());
+	for(int j=0;j<cl.size();j++)sorted[begin[rank[row_group[j]]]++]=j;
+}
+//总课表索引函数, 只建立输出课表所需的选课序号与名称宽度部分 
+//row的大小不超过CATALOG_ROW_DENSE, 更大的选课序号不会使其过度增长 
+void index_Curriculum_row(const vector<_Curriculum>&cl,struct _Catalog_Index &index)
+{
+	index.row.clear();
+	index.row_sparse.clear();
+	index.width.resize(cl.size());
+	for(int j=0;j<cl.size();j++)
+	{
+		index.width[j]=strlen(cl[j].class_name);
+		if(cl[j].number<0)continue;
+		if(cl[j].number>=CATALOG_ROW_DENSE)
+		{
+			index.row_sparse.push_back(make_pair(cl[j].number,j));
+			continue;
+		}
+		if(cl[j].number>=index.row.size())index.row.resize(cl[j].number+1,-1);
+		if(index.row[cl[j].number]<0)index.row[cl[j].number]=j;
+	}
+	sort(index.row_sparse.begin(),index.row_sparse.end());	//同一选课序号的各行中首行排在最前 
+	vector<pair<int,int> >::iterator last=index.row_sparse.begin();
+	for(int k=0;k<index.row_sparse.size();k++)
+	{
+		if(k==0||index.row_sparse[k].first!=index.row_sparse[k-1].first)*last++=index.row_sparse[k];
+	}
+	index.row_sparse.erase(last,index.row_sparse.end());
+}
+//由选课序号查找总课表中对应的第一行, 没有时返回-1 
+int index_Curriculum_find(const struct _Catalog_Index &index,int number)
+{
+	if(number<0)return(-1);
+	if(number<CATALOG_ROW_DENSE)return(number<index.row.size()?index.row[number]:-1);
+	vector<pair<int,int> >::const_iterator it=lower_bound(index.row_sparse.begin(),index.row_sparse.end(),make_pair(number,-1));
+	return(it!=index.row_sparse.end()&&it->first==number?it->second:-1);
+}
+//总课表索引函数, 读入文本总课表后建立一次, 供delivery与输出课表时查找; 读入二进制总课表时已一并读入 
+void index_Curriculum(const vector<_Curriculum>&cl,struct _Catalog_Index &index)
 {
+	sort_Curriculum(cl,&_Curriculum::num,index.number);
+	sort_Curriculum(cl,&_Curriculum::class_name,index.name);
+	index_Curriculum_row(cl,index);
+}
+//二进制总课表生成函数, 把已读入的总课表连同解析好的数值字段写入filename, 失败时返回false 
+//source为读入的文本总课表, 其大小与修改时间写入文件头, 供input_Curriculum_compiled判断是否过期 
+bool compile_Curriculum(const vector<_Curriculum>&cl,const char filename[]="Curriculum_balitai.bin",const char source[]="Curriculum_balitai.txt")
+{
+	map<string,unsigned int>intern;	//字符串在字符串池中的偏移 
+	string pool;
+	vector<_Catalog_Record>record(cl.size());
+	for(int i=0;i<cl.size();i++)
+	{
+		char *field[7]={cl[i].num,cl[i].class_name,cl[i].teacher_name,cl[i].week,cl[i].course_duration,cl[i].course_week,cl[i].address};
+		for(int f=0;f<7;f++)
+		{
+			map<string,unsigned int>::iterator it=intern.find(field[f]);
+			if(it==intern.end())
+			{
+				it=intern.insert(make_pair(string(field[f]),(unsigned int)pool.size())).first;
+				pool.append(field[f]);
+				pool.push_back('\0');
+			}
+			record[i].field[f]=it->second;
+		}
+		record[i].number=cl[i].number;
+		record[i].day=cl[i].day;
+		record[i].period_first=cl[i].period_first;
+		record[i].period_last=cl[i].period_last;
+		record[i].weeks=cl[i].weeks;
+	}
+	vector<int>number,name;	//排好序的行号, 映射后直接作为索引 
+	sort_Curriculum(cl,&_Curriculum::num,number);
+	sort_Curriculum(cl,&_Curriculum::class_name,name);
+	while(pool.size()%4!=0)pool.push_back('\0');	//文件大小保持4字节对齐 
+	_Catalog_Header header;
+	memcpy(header.magic,CATALOG_MAGIC,4);
+	header.version=CATALOG_VERSION;
+	header.order=0x01020304;
+	header.rows=record.size();
+	header.pool_size=pool.size();
+	header.reserved=0;
+	if(!stat_file(source,header.source_size,header.source_time))
+	{
+		header.source_size=0;
+		header.source_time=0;
+	}
 	FILE *fp;
-	if((fp=fopen("Curriculum_balitai.txt","r"))==NULL)
+	if((fp=fopen(filename,"wb"))==NULL)return(false);
+	bool success=fwrite(&header,sizeof(header),1,fp)==1;
+	if(success&&!record.empty())success=fwrite(&record[0],sizeof(_Catalog_Record),record.size(),fp)==record.size();
+	if(success&&!number.empty())success=fwrite(&number[0],sizeof(int),number.size(),fp)==number.size();
+	if(success&&!name.empty())success=fwrite(&name[0],sizeof(int),name.size(),fp)==name.size();
+	if(success&&!pool.empty())success=fwrite(pool.data(),1,pool.size(),fp)==pool.size();
+	if(fclose(fp)!=0)success=false;
+	return(success);
+}
+//二进制总课表录入函数, 映射compile_Curriculum生成的文件, 字符串字段直接指向映射中的字符串池, 不再解析文本 
+//总课表在file关闭前有效, 返回读入的行数; 文件不存在, 版本或字节序不符, 内容损坏以及文本总课表source在编译后被改动时返回-1, 可改为读取文本总课表 
+//source不存在时照常读取二进制总课表, 可只发布二进制文件; 文件中排好序的行号一并读入index, 不必再调用index_Curriculum 
+int input_Curriculum_compiled(vector<_Curriculum>&cl,struct _Catalog_Index &index,Mapped_File &file,const char filename[]="Curriculum_balitai.bin",const char source[]="Curriculum_balitai.txt")
+{
+	if(!file.open(filename,false))return(-1);
+	char *data=file.data();
+	_Catalog_Header header;
+	if(file.size()<sizeof(header))return(-1);
+	memcpy(&header,data,sizeof(header));
+	if(memcmp(header.magic,CATALOG_MAGIC,4)!=0||header.version!=CATALOG_VERSION||header.order!=0x01020304)return(-1);
+	unsigned long long source_size;
+	long long source_time;
+	if(stat_file(source,source_size,source_time)&&(source_size!=header.source_size||source_time!=header.source_time))return(-1);	//编译后文本总课表已改动 
+	const size_t row_size=sizeof(_Catalog_Record)+2*sizeof(int);	//每行的记录与两个行号 
+	if((file.size()-sizeof(header))/row_size<header.rows||file.size()!=sizeof(header)+(size_t)header.rows*row_size+header.pool_size)return(-1);
+	if(header.rows>0&&(header.pool_size==0||data[file.size()-1]!='\0'))return(-1);	//字符串池须以'\0'结尾 
+	const _Catalog_Record *record=(const _Catalog_Record*)(data+sizeof(header));	//文件头, 记录与行号均为4字节对齐 
+	const int *number=(const int*)(record+header.rows);
+	const int *name=number+header.rows;
+	char *pool=data+sizeof(header)+(size_t)header.rows*row_size;
+	for(int i=0;i<header.rows;i++)
+	{
+		if(number[i]<0||number[i]>=header.rows||name[i]<0||name[i]>=header.rows)return(-1);
+	}
+	cl.clear();
+	cl.resize(header.rows);
+	for(int i=0;i<header.rows;i++)
 	{
-		printf("Can't open file: Curriculum_balitai.txt!\n");
-		system("pause");
-		exit(1);
- 	}
-	for(int i=0;i<N;i++)
+		for(int f=0;f<7;f++)
+		{
+			if(record[i].field[f]>=header.pool_size)
+			{
+				cl.clear();
+				return(-1);
+			}
+		}
+		cl[i].num=pool+record[i].field[0];
+		cl[i].class_name=pool+record[i].field[1];
+		cl[i].teacher_name=pool+record[i].field[2];
+		cl[i].week=pool+record[i].field[3];
+		cl[i].course_duration=pool+record[i].field[4];
+		cl[i].course_week=pool+record[i].field[5];
+		cl[i].address=pool+record[i].field[6];
+		cl[i].number=record[i].number;
+		cl[i].day=record[i].day;
+		cl[i].period_first=record[i].period_first;
+		cl[i].period_last=record[i].period_last;
+		cl[i].weeks=record[i].weeks;
+	}
+	index.number.assign(number,number+header.rows);
+	index.name.assign(name,name+header.rows);
+	index_Curriculum_row(cl,index);
+	return(header.rows);
+}
+int input_Curriculum_compiled(vector<_Curriculum>&cl,Mapped_File &file,const char filename[]="Curriculum_balitai.bin",const char source[]="Curriculum_balitai.txt")
+{
+	struct _Catalog_Index index;
+	return(input_Curriculum_compiled(cl,index,file,filename,source));
+}
+//读入一整行, 不含行尾的换行符, 文件结束且没有读到字符时返回false 
+bool read_line(FILE *fp,string &line)
+{
+	int c;
+	line.clear();
+	while((c=fgetc(fp))!=EOF&&c!='\n')line+=(char)c;
+	if(!line.empty()&&line[line.size()-1]=='\r')line.erase(line.size()-1);
+	return c!=EOF||!line.empty();
+}
+//按空白字符切分一行 
+void split_fields(const string &line,vector<string>&field)
+{
+	field.clear();
+	for(size_t p=0;p<line.size();)
 	{
-		fscanf(fp,"%s\t%s\t%s\t%s\t%s\t%s\t%s\n",cl[i].num,cl[i].class_name,cl[i].teacher_name,cl[i].week,cl[i].course_duration,cl[i].course_week,cl[i].address);
+		if(isspace((unsigned char)line[p])){p++;continue;}
+		size_t q=p;
+		while(q<line.size()&&!isspace((unsigned char)line[q]))q++;
+		field.push_back(line.substr(p,q-p));
+		p=q;
 	}
-	fclose(fp);
 }
-//选课数据录入函数 
-void input_Syllabus(struct _Syllabus cu[])
+//选课数据录入函数, 先统计行数, 一次分配后逐行读入, 读到"break"或文件结束为止, 文件无法打开时返回false 
+//每行为选课序号, 课程名称与教师姓名三个字段, 字段数不符或超出_Syllabus的数组长度时跳过该行并提示, 不截断 
+bool input_Syllabus(vector<_Syllabus>&cu,struct _Session &session,const char filename[]="Syllabus.txt")
 {
 	FILE *fp_input;
-	if((fp_input=fopen("Syllabus.txt","r"))==NULL)
+	if((fp_input=fopen(filename,"r"))==NULL)
 	{
-		printf("Can't open file: Syllabus.txt!\n");
-		system("pause");
-		exit(1);
+		printf("Can't open file: %s!\n",filename);
+		cu.clear();
+		session.flat=0;
+		session.elective=-1;
+		return(false);
 	}
-	for(int i=0;i<30;i++)
+	int rows=1;
+	for(int c;(c=fgetc(fp_input))!=EOF;)
 	{
-		fscanf(fp_input,"%s%s%s",cu[i].num,cu[i].class_name,cu[i].teacher_name);
+		if(c=='\n')rows++;
+	}
+	rewind(fp_input);
+	cu.clear();
+	cu.resize(rows);
+	session.elective=-1;
+	int i=0;
+	string line;
+	vector<string>field;
+	for(int row=1;i<rows&&read_line(fp_input,line);row++)
+	{
+		split_fields(line,field);
+		if(field.empty())continue;	//空行 
+		if(field.size()!=3)
+		{
+			if(field[0]=="break")break;
+			printf("%s line %d: expected 3 fields, skipped!\n",filename,row);
+			continue;
+		}
+		if(field[0].size()>=sizeof(cu[i].num)||field[1].size()>=sizeof(cu[i].class_name)||field[2].size()>=sizeof(cu[i].teacher_name))
+		{
+			printf("%s line %d: field too long, skipped!\n",filename,row);
+			continue;
+		}
+		strcpy(cu[i].num,field[0].c_str());
+		strcpy(cu[i].class_name,field[1].c_str());
+		strcpy(cu[i].teacher_name,field[2].c_str());
+		if(strcmp(cu[i].num,"elective")==0&&session.elective<0)	//此行之后为选修课, 本行不计入课程数据 
+		{
+			session.elective=i;
+			continue;
+		}
 		if(i>0)
 		{
 			if(strcmp(cu[i].num,"break")==0)
 			{
-				flat=i;															//flat为数据终止判定 
 				break;
 			}
 		}
+		i++;
 	}
+	session.flat=i;	//flat为数据终止判定, 即读入的课程数据条数 
+	cu.resize(session.flat);
 	/*
-		for(int i=0;i<flat;i++)
+		for(int i=0;i<session.flat;i++)
 		{
 			printf("%s\t%s\t%s\n",cu[i].num,cu[i].class_name,cu[i].teacher_name);
 		}
 	*/
 	fclose(fp_input);
+	return(true);
 }
-//数据传递函数 
-void delivery(struct _Lesson de[],struct _Curriculum cl[],struct _Syllabus cu[])
+//数据传递函数, 课程时间按日历格式Calendar转换为课程表中的位置 
+//课程信息的条数由匹配结果决定, 由索引查出选课序号或课程名称相同的行, 不再逐行比较 
+template<typename Calendar>
+void delivery(vector<_Lesson>&de,const vector<_Curriculum>&cl,const struct _Catalog_Index &index,const vector<_Syllabus>&cu,struct _Session &session)
 {
 	int q=0;
-	char del_temp[40];
-	del_temp[0]='2',del_temp[1]='3',del_temp[2]='3',del_temp[3]='3';
-	for(int i=0,k=0;i<flat;i++)
+	de.clear();
+	const char *del_temp="2333";
+	vector<int>row;	//选课序号或课程名称相同的行, 按升序排列 
+	_Catalog_Less by_number={&cl,&_Curriculum::num},by_name={&cl,&_Curriculum::class_name};
+	pair<vector<int>::const_iterator,vector<int>::const_iterator>row_number,row_name;
+	bool outside=false;	//当前课程是否有超出日历的行 
+	session.elective_lesson=-1;
+	for(int i=0,k=0;i<session.flat;i++)
 	{
-	 	for(int j=0;j<N;j++)
+		if(i==session.elective)session.elective_lesson=q;	//选修课的课程信息从此开始 
+		row_number=equal_range(index.number.begin(),index.number.end(),(const char*)cu[i].num,by_number);
+		row_name=equal_range(index.name.begin(),index.name.end(),(const char*)cu[i].class_name,by_name);
+		row.clear();
+		set_union(row_number.first,row_number.second,row_name.first,row_name.second,back_inserter(row));
+	 	for(int r=0;r<row.size();r++)
 	 	{
-	 		if((strcmp(cu[i].num,cl[j].num)==0||strcmp(cu[i].class_name,cl[j].class_name)==0)&&(strcmp(cu[i].teacher_name,cl[j].teacher_name)==0||(cu[i].teacher_name[0]=='N'&&cu[i].teacher_name[1]=='U')))
+	 		int j=row[r];
+	 		if(strcmp(cu[i].teacher_name,cl[j].teacher_name)==0||(cu[i].teacher_name[0]=='N'&&cu[i].teacher_name[1]=='U'))	//教师为NULL时不限教师 
 	 		{
-				int F1(char str[]);
-	 			int F2(char str[]);
-	 			int F3(char str[]);
-	 			int F4(char str[]);
-	 			int F5(char str[]);
-	 			int F6(char str[]);
 	 			int term;
-				de[q].number=F1(cl[j].num);
+				if(q==de.size())de.push_back(_Lesson());
+				de[q].number=cl[j].number;
 	 			if(strcmp(cl[j].class_name,del_temp)==0)
 				{
 	 				de[q].course=k-1;
@@ -143,35 +530,48 @@ void delivery(struct _Lesson de[],struct _Curriculum cl[],struct _Syllabus cu[])
 					de[q].course=k;
 					k++;
 				}
-				strcpy(del_temp,cl[j].class_name);
-				if(F5(cl[j].course_week)<=12&&F5(cl[j].course_week)>=8)
-				{	
-					for(term=F3(cl[j].course_duration);term<=F4(cl[j].course_duration);term++)
-					{
-						de[q].time.push_back((F2(cl[j].week)-1)*14+term+98-1);
-					}
+				del_temp=cl[j].class_name;
+				if(cl[j].day<1||cl[j].day>Calendar::days||cl[j].period_first<1||cl[j].period_last>Calendar::periods||cl[j].period_first>cl[j].period_last)
+				{
+					outside=true;	//星期或节次超出日历, 整门课程都无法安排 
 				}
-				else
-				if(F6(cl[j].course_week)<=12&&F6(cl[j].course_week)>=8)
+				unsigned int weeks=cl[j].weeks;	//上课的周次, 第w周对应第w-1位 
+				if(Calendar::weeks<32)weeks&=(1u<<Calendar::weeks)-1;
+				if(weeks==0)weeks=~0u;	//无法识别时视为每周都有课 
+				int in_term[Calendar::terms]={0},most=0;	//每个学期段中上课的周数 
+				for(int w=0;w<Calendar::weeks&&w<32;w++)
 				{
-					for(term=F3(cl[j].course_duration);term<=F4(cl[j].course_duration);term++)
-					{
-						de[q].time.push_back((F2(cl[j].week)-1)*14+term-1);
-					}	
+					if(weeks>>w&1)in_term[Calendar::term(w)]++;
 				}
-				else
+				for(int t=0;t<Calendar::terms;t++)
 				{
-					for(term=F3(cl[j].course_duration);term<=F4(cl[j].course_duration);term++)
+					if(in_term[t]>most)most=in_term[t];
+				}
+				for(int t=0;t<Calendar::terms&&!outside;t++)	//课表中只显示在周数最多的学期段, 以及周数不少于其一半的学期段 
+				{
+					if(in_term[t]==0||2*in_term[t]<most)continue;
+					for(term=cl[j].period_first;term<=cl[j].period_last;term++)
 					{
-						de[q].time.push_back((F2(cl[j].week)-1)*14+term-1);
+						de[q].time.push_back(t*Calendar::term_size+(cl[j].day-1)*Calendar::periods+term-1);
 					}
-					for(term=F3(cl[j].course_duration);term<=F4(cl[j].course_duration);term++)
+				}
+				for(term=cl[j].period_first;term<=cl[j].period_last&&!outside;term++)
+				{
+					int slot=(cl[j].day-1)*Calendar::periods+term-1;
+					for(int w=0;w<Calendar::weeks&&w<32;w++)
 					{
-						de[q].time.push_back((F2(cl[j].week)-1)*14+term+98-1);
-					}		
+						if(weeks>>w&1)de[q].week_time.push_back(slot*Calendar::weeks+w);	//按周次的时间, 用于精确判断冲突 
+					}
 				}
-				if (strcmp(cl[j].num,j>0?cl[j+1].num:"2333")!=0) //(j>0?cl[j+1].num:"")
+				if (strcmp(cl[j].num,j>0&&j+1<cl.size()?cl[j+1].num:"2333")!=0) //(j>0?cl[j+1].num:"")
 				{
+					if(outside)	//清空时间, setlesson会跳过这门课程 
+					{
+						printf("Lesson %s is outside the calendar, skipped!\n",cl[j].num);
+						de[q].time.clear();
+						de[q].week_time.clear();
+						outside=false;
+					}
 					q++;
 				}
 				
@@ -179,120 +579,172 @@ void delivery(struct _Lesson de[],struct _Curriculum cl[],struct _Syllabus cu[])
 		}
 	}
 } 
-//课表输出函数 
-void output(struct _Curriculum cl[])
+//数据传递函数, 使用默认日历 
+void delivery(vector<_Lesson>&de,const vector<_Curriculum>&cl,const struct _Catalog_Index &index,const vector<_Syllabus>&cu,struct _Session &session)
 {
-	int F1(char str[]);
-	int flat;
-	cout<<endl<<"Output Table:"<<endl;
-	for (int i = 0; i < class_Table.size(); i++)
-	{
-		cout<<endl<<"第"<<(i+1)<<"张课表"<<endl<<endl;
-		cout<<"上半学期: "<<endl;
-		cout << "------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------" << endl;
-   		cout << setiosflags(ios::left) << setw(14) << "节次&星期" << resetiosflags(ios::left)
-       		 << setiosflags(ios::right) << setw(7) << "星期一" << setw(27) << "星期二" << setw(27) << "星期三"
-			 << setw(27) << "星期四"<< setw(27) << "星期五"<< setw(27) << "星期六"<< setw(27) 
-			 << "星期日"<< resetiosflags(ios::right) << endl;
-	    cout << "------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------" << endl;
-		for (int j = 0; j < 14; j++)
+	delivery<_Calendar_default>(de,cl,index,cu,session);
+}
+//数据传递函数, 临时建立索引 
+template<typename Calendar>
+void delivery(vector<_Lesson>&de,const vector<_Curriculum>&cl,const vector<_Syllabus>&cu,struct _Session &session)
+{
+	struct _Catalog_Index index;
+	index_Curriculum(cl,index);
+	delivery<Calendar>(de,cl,index,cu,session);
+}
+//数据传递函数, 使用默认日历, 临时建立索引 
+void delivery(vector<_Lesson>&de,const vector<_Curriculum>&cl,const vector<_Syllabus>&cu,struct _Session &session)
+{
+	delivery<_Calendar_default>(de,cl,cu,session);
+}
+//教室扣分函数, 地址中含有building的课程在评分模型中扣weight分 
+void score_address(struct _Score_Model &model,const vector<_Curriculum>&cl,const char building[],int weight)
+{
+	vector<int>added;	//已扣分的选课序号, 同一课程的多行只扣一次 
+	for(int x=0;x<cl.size();x++)
+	{
+		if(strstr(cl[x].address,building)!=NULL)
 		{
-			cout << setiosflags(ios::left) << setw((-(j+1)/10+1)*3) << "第" << j+1 << "节课" << resetiosflags(ios::left)<< setiosflags(ios::right) << setw(4) ; 
-			for (int k=0;k<7;k++)
+			int number=cl[x].number;
+			if(find(added.begin(),added.end(),number)==added.end())
 			{
-				cout<< '|' ;
-				if(class_Table[i][j+14*k].number==-1)cout<<' ';else
-				if(class_Table[i][j+14*k].number==class_Table[i][j+14*k-1].number)
-				{
-					for(int x=0;x<N;x++)
-					{
-						if(class_Table[i][j+14*k].number==F1(cl[x].num))
-						{
-							cout<<cl[x].class_name;
-							flat=x;
-							break;
-						}
-					}
-				}else
-				cout<<class_Table[i][j+14*k].number;
-				if(k!=6)
-				{
-					if(class_Table[i][j+14*k].number==-1)cout<<setw(26);else
-					if(class_Table[i][j+14*k].number==class_Table[i][j+14*k-1].number)
-					{
-						int y;
-						for(y=0;cl[flat].class_name[y]!='\0';y++);
-						cout<< setw(27-y) ;
-					}
-					else
-					{
-						if(class_Table[i][j+14*k].number>999)
-						cout<< setw(23) ;else
-						if(class_Table[i][j+14*k].number>99)
-						cout<< setw(24) ;else
-						if(class_Table[i][j+14*k].number>9)
-						cout<< setw(25) ;else
-						cout<< setw(26) ;
-					}
-				}
+				model.lesson_penalty[number]+=weight;
+				added.push_back(number);
 			}
-			cout<< resetiosflags(ios::right) << endl;
-			cout << "------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------"<<endl ;
 		}
-		cout<<endl<<"下半学期: "<<endl;
-		cout << "------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------" << endl;
-   		cout << setiosflags(ios::left) << setw(14) << "节次&星期" << resetiosflags(ios::left)
-       		 << setiosflags(ios::right) << setw(9) << "星期一" << setw(27) << "星期二" << setw(27) << "星期三"
-			 << setw(27) << "星期四"<< setw(27) << "星期五"<< setw(27) << "星期六"<< setw(27) 
-			 << "星期日"<< resetiosflags(ios::right) << endl;
-	    cout << "------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------" << endl;
-		for (int j = 98; j < 112; j++)
+	}
+}
+//附加项查找函数, 给出在不同周次与第pos节共用的各门课程的选课序号, 附加项从课程表的第size项开始 
+void table_share(const vector<_Table>&table,int size,int pos,vector<int>&share)
+{
+	share.clear();
+	for(int x=size;x<table.size();x++)
+	{
+		if(table[x].List_number==pos)share.push_back(table[x].number);
+	}
+}
+//单张课表输出函数, 可在Arrange::enumerate中逐张调用, 按日历格式Calendar排版 
+//课程名称及其宽度由总课表索引catalog直接查出, 不再逐行查找 
+template<typename Calendar>
+void output_table(const vector<_Curriculum>&cl,const struct _Catalog_Index &catalog,const vector<_Table>&table,int index)
+{
+	int flat=-1;
+	vector<int>share,share_prev;	//在不同周次与本节及上一节共用的课程 
+	const char *term_name[]={"上半学期","下半学期"};
+	const char *day_name[]={"星期一","星期二","星期三","星期四","星期五","星期六","星期日"};
+	string line(192-27*(7-Calendar::days),'-');	//默认日历下为192个'-' 
+	cout<<endl<<"第"<<(index+1)<<"张课表"<<endl;
+	for (int t = 0; t < Calendar::terms; t++)
+	{
+		cout<<endl;
+		if(Calendar::terms==2)cout<<term_name[t]<<": "<<endl;else
+		if(Calendar::terms>1)cout<<"第"<<t+1<<"段学期: "<<endl;
+		cout << line << endl;
+   		cout << setiosflags(ios::left) << setw(14) << "节次&星期" << resetiosflags(ios::left) << setiosflags(ios::right);
+		for (int k=0;k<Calendar::days;k++)
+		{
+			cout << setw(k==0?7:27) << day_name[k%7];
+		}
+		cout << resetiosflags(ios::right) << endl;
+	    cout << line << endl;
+		for (int j = 0; j < Calendar::periods; j++)
 		{
-			cout << setiosflags(ios::left) << setw((-(j-97)/10+1)*3) << "第" << j-98+1 << "节课" << resetiosflags(ios::left)<< setiosflags(ios::right) << setw(4) ; 
-			for (int k=0;k<7;k++)
+			cout << setiosflags(ios::left) << setw((-(j+1)/10+1)*3) << "第" << j+1 << "节课" << resetiosflags(ios::left)<< setiosflags(ios::right) << setw(4) ; 
+			for (int k=0;k<Calendar::days;k++)
 			{
+				int pos=t*Calendar::term_size+k*Calendar::periods+j;	//课程表中的位置 
+				const _Table &cell=table[pos];
+				table_share(table,Calendar::size,pos,share);
+				bool same=pos>0&&cell.number==table[pos-1].number;	//与上一节是同样的课时输出课程名称 
+				if(same)
+				{
+					table_share(table,Calendar::size,pos-1,share_prev);
+					same=share==share_prev;
+				}
+				int width=1;	//本节已输出的宽度 
 				cout<< '|' ;
-				if(class_Table[i][j+14*k].number==-1)cout<<' ';else
-				if(class_Table[i][j+14*k].number==class_Table[i][j+14*k-1].number)
+				if(cell.number==-1)cout<<' ';else
 				{
-					for(int x=0;x<N;x++)
+					width=0;
+					for(int s=-1;s<(int)share.size();s++)	//在不同周次共用这一节的课程以'/'分隔 
 					{
-						if(class_Table[i][j+14*k].number==F1(cl[x].num))
+						int number=s<0?cell.number:share[s];
+						if(s>=0)cout<<'/',width++;
+						if(same)
 						{
-							cout<<cl[x].class_name;
-							flat=x;
-							break;
+							flat=index_Curriculum_find(catalog,number);
+							if(flat>=0)cout<<cl[flat].class_name,width+=catalog.width[flat];
+						}
+						else
+						{
+							cout<<number;
+							for(int d=number;;d/=10)
+							{
+								width++;
+								if(d<10&&d>-10)break;
+							}
 						}
-					}
-				}else
-				cout<<class_Table[i][j+14*k].number;
-				if(k!=6)
-				{
-					if(class_Table[i][j+14*k].number==-1)cout<<setw(26);else
-					if(class_Table[i][j+14*k].number==class_Table[i][j+14*k-1].number)
-					{
-						int y;
-						for(y=0;cl[flat].class_name[y]!='\0';y++);
-						cout<< setw(27-y) ;
-					}
-					else
-					{
-						if(class_Table[i][j+14*k].number>999)
-						cout<< setw(23) ;else
-						if(class_Table[i][j+14*k].number>99)
-						cout<< setw(24) ;else
-						if(class_Table[i][j+14*k].number>9)
-						cout<< setw(25) ;else
-						cout<< setw(26) ;
 					}
 				}
+				if(k!=Calendar::days-1)cout<< setw(27-width) ;
 			}
 			cout<< resetiosflags(ios::right) << endl;
-			cout << "------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------"<<endl ;
+			cout << line <<endl ;
 		}
-		cout<<endl;
 	}
-} 
+	cout<<endl;
+}
+//单张课表输出函数, 临时建立索引, 连续输出多张课表时应先用index_Curriculum建立索引 
+template<typename Calendar>
+void output_table(const vector<_Curriculum>&cl,const vector<_Table>&table,int index)
+{
+	struct _Catalog_Index catalog;
+	index_Curriculum_row(cl,catalog);
+	output_table<Calendar>(cl,catalog,table,index);
+}
+//单张课表输出函数, 使用默认日历 
+void output_table(const vector<_Curriculum>&cl,const struct _Catalog_Index &catalog,const vector<_Table>&table,int index)
+{
+	output_table<_Calendar_default>(cl,catalog,table,index);
+}
+void output_table(const vector<_Curriculum>&cl,const vector<_Table>&table,int index)
+{
+	output_table<_Calendar_default>(cl,table,index);
+}
+//逐张输出课表的visitor, 供Arrange::enumerate与Arrange_Stage::enumerate使用, 课表在搜索中即输出, 不保存 
+template<typename Calendar>
+struct _Table_Output_T
+{
+	const vector<_Curriculum>*cl;
+	const struct _Catalog_Index *catalog;
+	int index;	//下一张课表的序号 
+	bool operator()(const vector<_Table>&table)
+	{
+		output_table<Calendar>(*cl,*catalog,table,index++);
+		return true;
+	}
+};
+typedef _Table_Output_T<_Calendar_default> _Table_Output;
+//课表输出函数 
+template<typename Calendar>
+void output(const vector<_Curriculum>&cl,const struct _Catalog_Index &catalog,const struct _Session &session,Arrange_T<Calendar> &arrange)
+{
+	vector<_Table>table;
+	cout<<endl<<"Output Table:"<<endl;
+	for (int i = 0; i < session.class_Table.size(); i++)
+	{
+		arrange.buildtable(session.class_Table,i,table);	//课表在输出时才生成 
+		output_table<Calendar>(cl,catalog,table,i);
+	}
+}
+//课表输出函数, 临时建立索引 
+template<typename Calendar>
+void output(const vector<_Curriculum>&cl,const struct _Session &session,Arrange_T<Calendar> &arrange)
+{
+	struct _Catalog_Index catalog;
+	index_Curriculum_row(cl,catalog);
+	output(cl,catalog,session,arrange);
+}
 //字符串转换整形数据函数 
 int F1(char str[])
 {
@@ -368,4 +820,37 @@ int F6(char str[])
 	return(sum);
 }
 
+//起止周次转换为周次的位掩码, 第w周对应第w-1位, 支持"1-17", "7,11", "1-14,17"以及"1-17单", "2-16双" 
+//单双周按GBK编码识别, 同时兼容UTF-8编码的总课表 
+unsigned int F7(char str[])
+{
+	unsigned int weeks=0;
+	int i=0;
+	while(str[i]>='0'&&str[i]<='9')
+	{
+		int first=0,last=0,parity=0;	//parity为1时只取单周, 为2时只取双周 
+		for(;str[i]>='0'&&str[i]<='9';i++)
+		first=first*10+(str[i]-48);
+		last=first;
+		if(str[i]=='-')
+		{
+			last=0;
+			for(i++;str[i]>='0'&&str[i]<='9';i++)
+			last=last*10+(str[i]-48);
+		}
+		unsigned char c0=str[i],c1=c0?str[i+1]:0,c2=c1?str[i+2]:0;
+		if(c0==0xB5&&c1==0xA5)parity=1,i+=2;else	//GBK"单" 
+		if(c0==0xCB&&c1==0xAB)parity=2,i+=2;else	//GBK"双" 
+		if(c0==0xE5&&c1==0x8D&&c2==0x95)parity=1,i+=3;else	//UTF-8"单" 
+		if(c0==0xE5&&c1==0x8F&&c2==0x8C)parity=2,i+=3;	//UTF-8"双" 
+		for(int w=first;w<=last&&w<=32;w++)
+		{
+			if(w<1||(parity==1&&w%2==0)||(parity==2&&w%2==1))continue;
+			weeks|=1u<<(w-1);
+		}
+		if(str[i]==',')i++;
+	}
+	return(weeks);
+}
+
 #endif
@@ -0,0 +1,163 @@
+/**********************************************************
+ *
+ *                  Class Mapped File Lib
+ *                     class_map.h
+ *
+ *               Copyright (C) 2026 李想
+ * Released under the GNU General Public License Version 3
+ *
+ *********************************************************/
+
+#include<cstdio>
+#include<cstring>
+#include<vector>
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+#ifndef CLASS_MAP
+#define CLASS_MAP
+
+/**********************************************************
+ * 供读取总课表使用的只读文件映射, Windows下使用CreateFileMapping, 其他平台使用mmap
+ * 映射为写时复制, 可在内存中原地修改(如把分隔符改为'\0'), 不会写回文件
+ * 按文本映射时内容非空则总以'\n'结尾, 文件不以'\n'结尾时改为读入内存并补上'\n'
+ *********************************************************/
+
+//Mapped_File类，写时复制的文件映射
+class Mapped_File
+{
+    public:
+        Mapped_File()
+        {
+            view=NULL;
+            length=0;
+        }
+
+        ~Mapped_File()
+        {
+            close();
+        }
+
+        //对外接口：映射文件filename, text为false时按原样映射二进制文件, 失败时返回false
+        bool open(const char filename[],bool text=true)
+        {
+            close();
+#ifdef _WIN32
+            HANDLE file=CreateFileA(filename,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+            if (file==INVALID_HANDLE_VALUE) return false;
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file,&file_size))
+            {
+                CloseHandle(file);
+                return false;
+            }
+            length=(size_t)file_size.QuadPart;
+            if (length>0)
+            {
+                HANDLE mapping=CreateFileMappingA(file,NULL,PAGE_WRITECOPY,0,0,NULL);
+                if (mapping!=NULL)
+                {
+                    view=(char*)MapViewOfFile(mapping,FILE_MAP_COPY,0,0,0);
+                    CloseHandle(mapping); //映射视图在UnmapViewOfFile前一直有效
+                }
+            }
+            CloseHandle(file);
+#else
+            int file=::open(filename,O_RDONLY);
+            if (file<0) return false;
+            struct stat file_stat;
+            if (fstat(file,&file_stat)!=0)
+            {
+                ::close(file);
+                return false;
+            }
+            length=(size_t)file_stat.st_size;
+            if (length>0)
+            {
+                void *mapping=mmap(NULL,length,PROT_READ|PROT_WRITE,MAP_PRIVATE,file,0);
+                if (mapping!=MAP_FAILED) view=(char*)mapping;
+            }
+            ::close(file);
+#endif
+            if (length>0&&view==NULL)
+            {
+                length=0;
+                return false;
+            }
+            if (text&&length>0&&view[length-1]!='\n') //末尾没有换行时读入内存, 保证每行都以'\n'结束
+            {
+                copy.assign(view,view+length);
+                copy.push_back('\n');
+                unmap();
+                length=copy.size();
+            }
+            return true;
+        }
+
+        //对外接口：解除映射
+        void close(void)
+        {
+            unmap();
+            std::vector<char>().swap(copy);
+            length=0;
+        }
+
+        //对外接口：文件内容, 可原地修改
+        char *data(void)
+        {
+            return copy.empty()?view:&copy[0];
+        }
+
+        //对外接口：文件内容的字节数
+        size_t size(void) const
+        {
+            return length;
+        }
+
+    private:
+        char *view; //映射的视图, 未映射时为NULL
+        size_t length; //内容的字节数
+        std::vector<char>copy; //文件不以'\n'结尾时读入的内容
+
+        //视图只能有一个所有者, 禁止复制
+        Mapped_File(const Mapped_File &);
+        Mapped_File &operator=(const Mapped_File &);
+
+        //内部函数：解除视图
+        void unmap(void)
+        {
+            if (view==NULL) return;
+#ifdef _WIN32
+            UnmapViewOfFile(view);
+#else
+            munmap(view,length);
+#endif
+            view=NULL;
+        }
+};
+
+//读取文件的字节数与最后修改时间, 用于判断由其生成的文件是否过期, 文件不存在时返回false
+//修改时间在Windows下以100纳秒为单位, 其他平台以秒为单位, 只用于同一平台上的比较
+inline bool stat_file(const char filename[],unsigned long long &size,long long &time)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA file_data;
+    if (!GetFileAttributesExA(filename,GetFileExInfoStandard,&file_data)) return false;
+    size=(unsigned long long)file_data.nFileSizeHigh<<32|file_data.nFileSizeLow;
+    time=(long long)((unsigned long long)file_data.ftLastWriteTime.dwHighDateTime<<32|file_data.ftLastWriteTime.dwLowDateTime);
+#else
+    struct stat file_stat;
+    if (stat(filename,&file_stat)!=0) return false;
+    size=(unsigned long long)file_stat.st_size;
+    time=(long long)file_stat.st_mtime;
+#endif
+    return true;
+}
+
+#endif
@@ -0,0 +1,116 @@
+/**********************************************************
+ *
+ *                   Class Thread Pool Lib
+ *                     class_pool.h
+ *
+ *               Copyright (C) 2026 李想
+ * Released under the GNU General Public License Version 3
+ *
+ *********************************************************/
+
+#include<deque>
+#include<vector>
+#if __cplusplus >= 201103L
+#include<memory>
+#include<mutex>
+#include<thread>
+#endif
+
+#ifndef CLASS_POOL
+#define CLASS_POOL
+
+/**********************************************************
+ * 供Arrange多线程搜索使用的work-stealing线程池
+ * 任务以编号0~task_count-1表示, 按编号顺序分块分配给各线程
+ * 每个线程从自己队列的队首取任务, 空闲时从其他线程队列的队尾窃取
+ * 需要C++11及以上标准, 否则本文件为空
+ *********************************************************/
+
+#if __cplusplus >= 201103L
+
+//Steal_Pool类，work-stealing线程池
+class Steal_Pool
+{
+    public:
+        //构造函数，输入线程数, 不大于0时使用硬件线程数
+        Steal_Pool(int n=0)
+        {
+            thread_count=n>0?n:(int)std::thread::hardware_concurrency();
+            if (thread_count<=0) thread_count=1;
+        }
+
+        //对外接口：线程数
+        int size(void) const
+        {
+            return thread_count;
+        }
+
+        //对外接口：执行task(0)~task(task_count-1), 全部完成后返回
+        template<typename Task>void run(int task_count,Task &task)
+        {
+            int worker_count=thread_count<task_count?thread_count:task_count;
+            if (worker_count<=1)
+            {
+                for (int i=0;i<task_count;i++) task(i);
+                return;
+            }
+            queues.reset(new _Task_Queue[worker_count]);
+            queue_count=worker_count;
+            for (int i=0;i<task_count;i++)
+            {
+                queues[(long long)i*worker_count/task_count].tasks.push_back(i); //按编号分块, 相邻的子树尽量由同一线程完成
+            }
+            std::vector<std::thread>workers;
+            for (int w=1;w<worker_count;w++) workers.push_back(std::thread(&Steal_Pool::work<Task>,this,w,&task));
+            work(0,&task);
+            for (int w=0;w<workers.size();w++) workers[w].join();
+            queues.reset();
+        }
+
+    private:
+        int thread_count; //线程数
+        int queue_count; //任务队列数
+        //每个线程的任务队列
+        struct _Task_Queue
+        {
+            std::mutex lock;
+            std::deque<int>tasks;
+        };
+        std::unique_ptr<_Task_Queue[]>queues;
+
+        //内部函数：线程w的工作循环
+        template<typename Task>void work(int w,Task *task)
+        {
+            int index;
+            while (pop(w,index)||steal(w,index)) (*task)(index);
+        }
+
+        //内部函数：从自己队列的队首取任务
+        bool pop(int w,int &index)
+        {
+            std::lock_guard<std::mutex>guard(queues[w].lock);
+            if (queues[w].tasks.empty()) return false;
+            index=queues[w].tasks.front();
+            queues[w].tasks.pop_front();
+            return true;
+        }
+
+        //内部函数：从其他线程队列的队尾窃取任务
+        bool steal(int w,int &index)
+        {
+            for (int i=1;i<queue_count;i++)
+            {
+                _Task_Queue &victim=queues[(w+i)%queue_count];
+                std::lock_guard<std::mutex>guard(victim.lock);
+                if (victim.tasks.empty()) continue;
+                index=victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+            return false;
+        }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,308 @@
+/**********************************************************
+ *
+ *                Class Benchmark Program
+ *                    class_bench.cpp
+ *
+ *               Copyright (C) 2026 李想
+ * Released under the GNU General Public License Version 3
+ *
+ *********************************************************/
+
+#include<algorithm>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<iostream>
+#include<map>
+#include<string>
+#include<vector>
+#ifdef _WIN32
+#define PSAPI_VERSION 2
+#include<windows.h>
+#include<psapi.h>
+#else
+#include<sys/resource.h>
+#endif
+
+using namespace std;
+
+#include"class\class_data.h"
+#include"class\class_arrg.h"
+
+/**********************************************************
+ * 用随机生成的课程信息测试Arrange各接口的用时, 不读取任何文件
+ * 参数: 课程大纲数, 每项课程大纲的课程数, 每门课程的节数, 冲突密度, 是否按周次
+ * 冲突密度为一张课程表占用的节数与可用节数之比, 越大冲突越多
+ * 按周次时每节课随机取全学期、上半学期、下半学期、单周或双周上课, 与delivery一样生成week_time
+ * 用法: class_bench [seed] 在默认网格上测试
+ *       class_bench seed 课程大纲数 课程数 节数 冲突密度 [是否按周次] 只测试一组参数
+ * 每个接口都在单独的子进程中运行(参数末尾加上接口名), 因此内存峰值只属于该接口
+ * 先用迭代器逐张计数, 课程表数量超过LIMIT的参数不再测试其他接口
+ *********************************************************/
+
+#define LIMIT 1000000	//课程表的数量上限
+#define AMOUNT_SAMPLE 1000	//getsample抽取的课程表数量
+#define AMOUNT_BEST 10	//getbest输出的课程表数量
+
+//测试参数
+struct _Bench_Case
+{
+	int course;	//课程大纲数
+	int section;	//每项课程大纲的课程数
+	int slot;	//每门课程的节数
+	double density;	//冲突密度
+	int weekly;	//是否按周次, 为0时每节课全学期上课且不生成week_time
+};
+
+//被测试的接口, 依次在子进程中运行
+const char *bench_engine[]={
+	"iterator",
+	"countlesson",
+	"setlesson+gettable",
+#if __cplusplus >= 201103L
+	"gettable_parallel",
+#endif
+	"enumerate",
+	"getsample",
+	"getbest",
+	"Arrange_Stage"
+};
+
+//由seed生成[0,range)内的随机数, 与rand()无关, 各平台结果一致
+int bench_random(unsigned long long &seed,int range)
+{
+	seed=seed*6364136223846793005ULL+1442695040888963407ULL;
+	return (int)((seed>>33)%(unsigned long long)range);
+}
+
+//生成课程信息, 每节课从前pool节中随机选取, 同一门课程的各节不重复, 返回课程数
+//按周次时只在一个学期段的节中选取, 再按所取的周次模式生成各学期段的time与week_time
+int bench_lesson(const _Bench_Case &bench,unsigned long long seed,vector<_Lesson>&de)
+{
+	typedef _Calendar_default Calendar;
+	int pool=(int)(bench.course*bench.slot/bench.density);
+	int pool_max=bench.weekly?Calendar::term_size:Calendar::size;
+	if(pool<bench.slot)pool=bench.slot;
+	if(pool>pool_max)pool=pool_max;
+	de.assign(bench.course*bench.section,_Lesson());
+	for(int c=0,q=0;c<bench.course;c++)
+	{
+		for(int s=0;s<bench.section;s++,q++)
+		{
+			vector<int>slot;
+			de[q].number=q;
+			de[q].course=c;
+			while(slot.size()<bench.slot)
+			{
+				int time=bench_random(seed,pool);
+				if(find(slot.begin(),slot.end(),time)==slot.end())slot.push_back(time);
+			}
+			if(!bench.weekly)
+			{
+				de[q].time=slot;
+				continue;
+			}
+			for(int i=0;i<slot.size();i++)
+			{
+				int mode=bench_random(seed,5);	//0全学期, 1上半学期, 2下半学期, 3单周, 4双周
+				int in_term[Calendar::terms]={0},most=0;
+				for(int w=0;w<Calendar::weeks;w++)
+				{
+					int term=Calendar::term(w);
+					if((mode==1&&term!=0)||(mode==2&&term==0)||(mode==3&&w%2==1)||(mode==4&&w%2==0))continue;
+					de[q].week_time.push_back(slot[i]*Calendar::weeks+w);
+					in_term[term]++;
+				}
+				for(int t=0;t<Calendar::terms;t++)
+				{
+					if(in_term[t]>most)most=in_term[t];
+				}
+				for(int t=0;t<Calendar::terms;t++)	//与delivery相同, 只记入周数不少于最多者一半的学期段
+				{
+					if(in_term[t]>0&&2*in_term[t]>=most)de[q].time.push_back(t*Calendar::term_size+slot[i]);
+				}
+			}
+		}
+	}
+	return de.size();
+}
+
+//进程占用内存的峰值, 单位为KB, 每个接口在单独的子进程中运行, 因此即为该接口的峰值
+long bench_memory(void)
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counter;
+	if(GetProcessMemoryInfo(GetCurrentProcess(),&counter,sizeof(counter)))return (long)(counter.PeakWorkingSetSize/1024);
+	return 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF,&usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss/1024;	//macOS以字节为单位
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+//只计数的visitor
+struct _Bench_Counter
+{
+	unsigned long long *amount;
+	bool operator()(const vector<_Table>&table)
+	{
+		(*amount)++;
+		return true;
+	}
+};
+
+//输出一行结果
+void bench_report(const _Bench_Case &bench,const char engine[],unsigned long long amount,double time)
+{
+	printf("%4d %4d %4d %6.2f %4d  %-18s %12llu %10.2f %10.3f %10ld\n",bench.course,bench.section,bench.slot,bench.density,bench.weekly,engine,amount,time*1000,amount?time*1e6/amount:0.0,bench_memory());
+	fflush(stdout);	//与子进程的输出保持顺序
+}
+
+//在当前进程中测试一个接口, 迭代器计数超过LIMIT时返回false
+bool bench_run(const _Bench_Case &bench,unsigned long long seed,const string &engine)
+{
+	vector<_Lesson>de;
+	int amount=bench_lesson(bench,seed,de);
+	double start;
+	if(engine=="iterator")
+	{
+		//迭代器只在需要时继续搜索, 先用它计数, 数量过多时提前结束
+		unsigned long long counted=0;
+		start=_Stats_Clock();
+		Arrange Arrange0(0,amount-1);
+		Arrange0.setlesson(&de[0]);
+		for(Arrange::iterator it=Arrange0.begin();it!=Arrange0.end()&&counted<=LIMIT;++it)counted++;
+		if(counted>LIMIT)
+		{
+			printf("%4d %4d %4d %6.2f %4d  more than %d tables, skipped\n",bench.course,bench.section,bench.slot,bench.density,bench.weekly,LIMIT);
+			return false;
+		}
+		bench_report(bench,"iterator",counted,_Stats_Clock()-start);
+	}
+	else if(engine=="countlesson")
+	{
+		map<int,unsigned long long>marginal;
+		start=_Stats_Clock();
+		Arrange Arrange1(0,amount-1);
+		Arrange1.setlesson(&de[0]);
+		unsigned long long total=Arrange1.countlesson(marginal);
+		bench_report(bench,"countlesson",total,_Stats_Clock()-start);
+	}
+	else if(engine=="setlesson+gettable")
+	{
+		start=_Stats_Clock();
+		Arrange Arrange2(0,amount-1);
+		Arrange2.setlesson(&de[0]);
+		Solution_Store table;
+		Arrange2.gettable(table);
+		bench_report(bench,"setlesson+gettable",table.size(),_Stats_Clock()-start);
+	}
+#if __cplusplus >= 201103L
+	else if(engine=="gettable_parallel")
+	{
+		start=_Stats_Clock();
+		Arrange Arrange3(0,amount-1);
+		Arrange3.setlesson(&de[0]);
+		Solution_Store table;
+		Arrange3.gettable_parallel(table);
+		bench_report(bench,"gettable_parallel",table.size(),_Stats_Clock()-start);
+	}
+#endif
+	else if(engine=="enumerate")
+	{
+		unsigned long long counted=0;
+		_Bench_Counter counter={&counted};
+		start=_Stats_Clock();
+		Arrange Arrange4(0,amount-1);
+		Arrange4.setlesson(&de[0]);
+		Arrange4.enumerate(counter);
+		bench_report(bench,"enumerate",counted,_Stats_Clock()-start);
+	}
+	else if(engine=="getsample")
+	{
+		start=_Stats_Clock();
+		Arrange Arrange5(0,amount-1);
+		Arrange5.setlesson(&de[0]);
+		Solution_Store sample;
+		Arrange5.getsample(AMOUNT_SAMPLE,seed,sample);
+		bench_report(bench,"getsample",sample.size(),_Stats_Clock()-start);
+	}
+	else if(engine=="getbest")
+	{
+		_Score_Model model;
+		model.early_weight=1;
+		model.day_weight=2;
+		model.gap_weight=1;
+		vector<vector<_Table> >table;
+		vector<long long>score;
+		start=_Stats_Clock();
+		Arrange Arrange6(0,amount-1);
+		Arrange6.setlesson(&de[0]);
+		Arrange6.getbest(AMOUNT_BEST,model,table,score);
+		bench_report(bench,"getbest",table.size(),_Stats_Clock()-start);
+	}
+	else if(engine=="Arrange_Stage")
+	{
+		int split=bench.course/2*bench.section;	//前一半课程大纲视为必修课
+		vector<vector<_Table> >table;
+		start=_Stats_Clock();
+		Arrange_Stage Arrange7(0,split-1,split,amount-1);
+		Arrange7.setlesson(&de[0]);
+		Arrange7.gettable(table);
+		bench_report(bench,"Arrange_Stage",table.size(),_Stats_Clock()-start);
+	}
+	return true;
+}
+
+//测试一组参数下的各接口, 每个接口由program在新的子进程中运行, 迭代器计数超过LIMIT时不再测试其他接口
+void bench_spawn(const char program[],const _Bench_Case &bench,unsigned long long seed)
+{
+	for(int e=0;e<sizeof(bench_engine)/sizeof(bench_engine[0]);e++)
+	{
+		char argument[128];
+		sprintf(argument," %llu %d %d %d %g %d ",seed,bench.course,bench.section,bench.slot,bench.density,bench.weekly);
+		string command="\""+string(program)+"\""+argument+bench_engine[e];
+		if(system(command.c_str())!=0)return;	//子进程返回非0即课程表过多或运行失败
+	}
+}
+
+/*************************
+		主函数main
+*************************/
+int main(int argc,char *argv[])
+{
+	unsigned long long seed=argc>1?strtoul(argv[1],NULL,10):2019;
+	if(argc>7)	//子进程: 只测试一个接口
+	{
+		_Bench_Case bench={atoi(argv[2]),atoi(argv[3]),atoi(argv[4]),atof(argv[5]),atoi(argv[6])};
+		return bench_run(bench,seed,argv[7])?0:1;
+	}
+	printf("%4s %4s %4s %6s %4s  %-18s %12s %10s %10s %10s\n","crs","sec","slot","dens","week","engine","tables","ms","us/table","peak KB");
+	fflush(stdout);
+	if(argc>5)
+	{
+		_Bench_Case bench={atoi(argv[2]),atoi(argv[3]),atoi(argv[4]),atof(argv[5]),argc>6?atoi(argv[6]):0};
+		bench_spawn(argv[0],bench,seed);
+		return 0;
+	}
+	//默认网格
+	const int course[]={4,8,12};
+	const int section[]={2,4,8};
+	const int slot[]={1,2,4};
+	const double density[]={0.1,0.3,0.6};
+	for(int a=0;a<3;a++)
+	for(int b=0;b<3;b++)
+	for(int c=0;c<3;c++)
+	for(int d=0;d<3;d++)
+	for(int w=0;w<2;w++)
+	{
+		_Bench_Case bench={course[a],section[b],slot[c],density[d],w};
+		bench_spawn(argv[0],bench,seed);
+	}
+	return 0;
+}
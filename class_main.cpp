@@ -22,31 +22,70 @@ using namespace std;
 #include"class\class_arrg.h"
 #include"class\class_io.h"
 
-#define N 2201   //八里台2201 津南1431 
-
 /*************************
 		主函数main 
+	class_main compile 把总课表编译为二进制文件Curriculum_balitai.bin
+	之后运行时直接映射该文件, 不存在或文本总课表在编译后被改动时读取文本总课表 
 *************************/
-int main()
+int main(int argc,char *argv[])
 {
-	void input_Curriculum(struct _Curriculum cl[]);	//原始数据录入函数 
-	void input_Syllabus(struct _Syllabus cu[]);	//选课数据录入函数 
-	void delivery(struct _Lesson de[],struct _Curriculum cl[],struct _Syllabus cu[]);	//数据传递函数
-	void output(struct _Curriculum cl[]);	//课表输出函数 
-	struct _Curriculum cl[N],*p_cl=cl;
-	struct _Syllabus cu[30],*p_cu=cu;
-	struct _Lesson de[50],*p_Lesson=de;
-	input_Curriculum(p_cl);
-	input_Syllabus(p_cu);
-	delivery(p_Lesson,p_cl,p_cu);
-	Arrange Arrange1(0,50-1,196); //根据我们的经验, 与用户教学大纲有关的课程数一般不高于50
-	Arrange1.setlesson(de);
-	cout<<"Now arranging, please wait..."<<endl<<endl;
-	bool success = Arrange1.gettable(class_Table);
-	cout<<"You get "<<Arrange1.getamount()<<" table(s)"<<endl<<endl;
-	if (success) cout<<"Success !"<<endl;
-	else cout<<"Failed !"<<endl;
-	output(p_cl);
+	vector<_Curriculum>cl;	//总课表, 行数由文件决定 
+	vector<_Syllabus>cu;
+	vector<_Lesson>de;
+	struct _Catalog_Index index;	//总课表的索引 
+	struct _Session session;
+	Mapped_File catalog_file;	//总课表的映射, cl中的字符串在main结束前一直有效 
+	if (argc>1&&strcmp(argv[1],"compile")==0)
+	{
+		if (input_Curriculum(cl,catalog_file)<0) return 1;
+		if (!compile_Curriculum(cl))
+		{
+			cout<<"Can't write file: Curriculum_balitai.bin!"<<endl;
+			return 1;
+		}
+		cout<<"Compiled "<<cl.size()<<" row(s)"<<endl;
+		return 0;
+	}
+	if (input_Curriculum_compiled(cl,index,catalog_file)<0)	//二进制总课表中已保存索引 
+	{
+		if (input_Curriculum(cl,catalog_file)<0)
+		{
+			system("pause");
+			return 1;
+		}
+		index_Curriculum(cl,index);
+	}
+	if (!input_Syllabus(cu,session))
+	{
+		system("pause");
+		return 1;
+	}
+	delivery(de,cl,index,cu,session);
+	int amount=de.size();
+	if (de.empty()) de.resize(1); //没有匹配的课程时保留一项空课程, setlesson会跳过它
+	if (session.elective_lesson<0)
+	{
+		Arrange Arrange1(0,amount-1);
+		Arrange1.setlesson(&de[0]);
+		cout<<"Now arranging, please wait..."<<endl<<endl;
+		bool success = Arrange1.gettable(session.class_Table);
+		cout<<"You get "<<Arrange1.getamount()<<" table(s)"<<endl<<endl;
+		if (success) cout<<"Success !"<<endl;
+		else cout<<"Failed !"<<endl;
+		output(cl,index,session,Arrange1);
+	}
+	else
+	{
+		Arrange_Stage Arrange2(0,session.elective_lesson-1,session.elective_lesson,amount-1); //先排必修课, 再排选修课
+		_Table_Output printer={&cl,&index,0};
+		Arrange2.setlesson(&de[0]);
+		cout<<"Now arranging, please wait..."<<endl<<endl;
+		cout<<"Output Table:"<<endl;
+		bool success = Arrange2.enumerate(printer);	//课表在搜索中逐张输出, 不保存全部课表 
+		cout<<endl<<"You get "<<Arrange2.getamount()<<" table(s)"<<endl<<endl;
+		if (success) cout<<"Success !"<<endl;
+		else cout<<"Failed !"<<endl;
+	}
 	system("pause");
 	return 0;
 }
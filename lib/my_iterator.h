@@ -26,6 +26,7 @@
 /************************************************************
  * 更新日志:
  * 2020.05.02 添加了部分功能函数
+ * 2026.10.17 advance改为按引用传入iter, 原先按值传入时调用方的迭代器不会前进
  ***********************************************************/
 
 #ifndef MY_ITERATOR
@@ -195,7 +196,7 @@ namespace my_lib
 
     //advance iter for n times的实现, 识别iterator_category
     template<typename _Iterator, typename _Distance>
-    inline void advance(_Iterator iter, _Distance _n) 
+    inline void advance(_Iterator& iter, _Distance _n) 
     {
 	    __advance(iter, _n, iterator_category(iter));
     }